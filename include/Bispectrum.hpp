@@ -21,8 +21,10 @@
 
 #include "DiagramSet3pointSPT.hpp"
 #include "DiagramSet3pointEFT.hpp"
+#include "EFTkernels.hpp"
 #include "KernelBase.hpp"
 #include "Integration.hpp"
+#include "ResultCache.hpp"
 
 namespace fnfast {
 
@@ -52,7 +54,13 @@ class Bispectrum
       DiagramSet3pointSPT _diagrams;      ///< 3-point diagrams
       DiagramSet3pointEFT _EFTdiagrams;   ///< 3-point EFT diagrams /*DAN*/
       double _UVcutoff;                   ///< UV cutoff for loop integrations
-      int _seed;                          ///< random number seed for VEGAS
+      int _seed;                          ///< random number seed of the integrations
+      IntegrationMethod _method;          ///< integration method of the loop integrals
+      double _epsrel;                     ///< relative accuracy of the integrals
+      int _maxeval;                       ///< maximum number of integrand evaluations of the integrals
+      std::string _statefile;             ///< checkpoint of the integration state, none if empty
+      ResultCache* _cache;                ///< cache of the loop integrals, nullptr if not cached
+      bool _reflectphi;                   ///< use the reflection symmetry through the k1-k2 plane in the loop integral
 
       /// container for the integration options
       struct LoopPhaseSpace
@@ -63,9 +71,11 @@ class Bispectrum
          double theta12;
          LabelMap<Momentum, ThreeVector> momenta;
          double qmax;
+         bool reflectphi;
          const LabelMap<Vertex, KernelBase*>* kernels;
          LinearPowerSpectrumBase* PL;
          const Bispectrum* bispectrum;
+         int diagram;
          static constexpr double pi = 3.14159265358979;
 
          /// constructor
@@ -106,20 +116,47 @@ class Bispectrum
       /// set the random number seed
       void set_seed(int seed) { _seed = seed; }
 
+      /// set the integration method of the loop integrals (VEGAS by default)
+      void set_method(IntegrationMethod method) { _method = method; }
+
+      /// set the relative accuracy and maximum number of integrand evaluations of the integrals
+      void set_accuracy(double epsrel, int maxeval) { _epsrel = epsrel; _maxeval = maxeval; }
+
+      /// set the checkpoint file of the integration state (see IntegratorBase::statefile), empty for none;
+      /// an integral interrupted with a checkpoint resumes from it when computed again
+      void set_statefile(const std::string& statefile) { _statefile = statefile; }
+
+      /// attach a cache of the loop integrals (see ResultCache), nullptr to detach
+      void set_cache(ResultCache* cache) { _cache = cache; }
+
+      /// attach a profile of the loop integrand diagrams (see DiagramProfile), nullptr to detach; profiled integrals are not taken from the cache
+      void set_profile(DiagramProfile* profile) { _diagrams.set_profile(profile); }
+
+      /// sample the loop momentum only on one side of the k1-k2 plane (default is true)
+      void set_phi_reflection(bool reflectphi) { _reflectphi = reflectphi; }
+
       /// get results differential in k
       /// tree level
       double tree(double k1, double k2, double theta12, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
       /// one loop integrated over q
       IntegralResult oneLoop(double k1, double k2, double theta12, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+      /// one loop integrated over q, for each diagram and in total
+      DiagramIntegrals oneLoop_diagrams(double k1, double k2, double theta12, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, GridMode mode = GridMode::kShared) const;
    
    
       /// EFT tree level, same order as SPT one loop
       /*DAN*/
       double treeEFT(double k1, double k2, double theta12, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+      /// EFT tree level decomposed in the counterterm coefficients, with EFT kernels at exactly one vertex (see EFTbasis)
+      EFTbasis treeEFT_basis(double k1, double k2, double theta12, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
 
    private:
+      /// integrator of the loop integrals with the method and settings, in this process only while a profile is attached
+      std::unique_ptr<IntegratorBase> make_integrator(int ndim) const;
       /// one loop integrand
       static int oneLoop_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
+      /// one loop integrand, a single diagram or the total and each diagram
+      static int oneLoop_diagrams_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -128,7 +165,7 @@ class Bispectrum
 
 //------------------------------------------------------------------------------
 inline Bispectrum::LoopPhaseSpace::LoopPhaseSpace(double k1mag, double k2mag, double theta12val, double qlim, const LabelMap<Vertex, KernelBase*>* kern, LinearPowerSpectrumBase* linPS, const Bispectrum* bispec)
-: ndim(3), k1(k1mag), k2(k2mag), theta12(theta12val), momenta(LabelMap<Momentum, ThreeVector> {{Momentum::k1, ThreeVector()}, {Momentum::k2, ThreeVector()}, {Momentum::k3, ThreeVector()}, {Momentum::q, ThreeVector()}}), qmax(qlim), kernels(kern), PL(linPS), bispectrum(bispec)
+: ndim(3), k1(k1mag), k2(k2mag), theta12(theta12val), momenta(LabelMap<Momentum, ThreeVector> {{Momentum::k1, ThreeVector()}, {Momentum::k2, ThreeVector()}, {Momentum::k3, ThreeVector()}, {Momentum::q, ThreeVector()}}), qmax(qlim), reflectphi(true), kernels(kern), PL(linPS), bispectrum(bispec), diagram(-1)
 {
    // set the external momenta
    momenta[Momentum::k1] = ThreeVector(0, 0, k1);
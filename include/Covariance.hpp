@@ -21,8 +21,10 @@
 
 #include "DiagramSet4pointSPT.hpp"
 #include "DiagramSet4pointEFT.hpp"
+#include "EFTkernels.hpp"
 #include "KernelBase.hpp"
 #include "Integration.hpp"
+#include "ResultCache.hpp"
 
 namespace fnfast {
 
@@ -52,7 +54,12 @@ class Covariance
       DiagramSet4pointSPT _diagrams;      ///< 4-point diagrams
       DiagramSet4pointEFT _EFTdiagrams;   ///< 4-point EFT diagrams /*DAN*/
       double _UVcutoff;                   ///< UV cutoff for loop integrations
-      int _seed;                          ///< random number seed for VEGAS
+      int _seed;                          ///< random number seed of the integrations
+      IntegrationMethod _method;          ///< integration method of the loop integrals
+      double _epsrel;                     ///< relative accuracy of the integrals
+      int _maxeval;                       ///< maximum number of integrand evaluations of the integrals
+      std::string _statefile;             ///< checkpoint of the integration state, none if empty
+      ResultCache* _cache;                ///< cache of the loop integrals, nullptr if not cached
 
       /// container for the integration options
       struct PhaseSpace
@@ -65,6 +72,7 @@ class Covariance
          const LabelMap<Vertex, KernelBase*>* kernels;
          LinearPowerSpectrumBase* PL;
          const Covariance* covariance;
+         int diagram;
          static constexpr double pi = 3.14159265358979;
 
          /// constructor
@@ -105,21 +113,45 @@ class Covariance
       /// set the random number seed
       void set_seed(int seed) { _seed = seed; }
 
+      /// set the integration method of the loop integrals (VEGAS by default)
+      void set_method(IntegrationMethod method) { _method = method; }
+
+      /// set the relative accuracy and maximum number of integrand evaluations of the integrals
+      void set_accuracy(double epsrel, int maxeval) { _epsrel = epsrel; _maxeval = maxeval; }
+
+      /// set the checkpoint file of the integration state (see IntegratorBase::statefile), empty for none;
+      /// an integral interrupted with a checkpoint resumes from it when computed again
+      void set_statefile(const std::string& statefile) { _statefile = statefile; }
+
+      /// attach a cache of the loop integrals (see ResultCache), nullptr to detach
+      void set_cache(ResultCache* cache) { _cache = cache; }
+
+      /// attach a profile of the loop integrand diagrams (see DiagramProfile), nullptr to detach; profiled integrals are not taken from the cache
+      void set_profile(DiagramProfile* profile) { _diagrams.set_profile(profile); }
+
       /// get results differential in k
       /// tree level
       IntegralResult tree(double k, double kprime, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
       /// one loop integrated over q, theta
       IntegralResult oneLoop(double k, double kprime, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+      /// one loop integrated over q, for each diagram and in total
+      DiagramIntegrals oneLoop_diagrams(double k, double kprime, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, GridMode mode = GridMode::kShared) const;
    
       /// EFT tree level, same order as SPT one loop
       /*DAN*/
       IntegralResult treeEFT(double k, double kprime, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+      /// EFT tree level decomposed in the counterterm coefficients, with EFT kernels at exactly one vertex (see EFTbasis)
+      EFTbasis treeEFT_basis(double k, double kprime, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
 
    private:
+      /// integrator of the loop integrals with the method and settings, in this process only while a profile is attached
+      std::unique_ptr<IntegratorBase> make_integrator(int ndim) const;
       /// one loop integrand
       static int tree_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
       /// one loop integrand
       static int oneLoop_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
+      /// one loop integrand, a single diagram or the total and each diagram
+      static int oneLoop_diagrams_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
       /// tree EFT integrand
       /*DAN*/
       static int treeEFT_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
@@ -131,7 +163,7 @@ class Covariance
 
 //------------------------------------------------------------------------------
 inline Covariance::PhaseSpace::PhaseSpace(double kmag, double kprimemag, double qlim, const LabelMap<Vertex, KernelBase*>* kern, LinearPowerSpectrumBase* linPS, const Covariance* cov)
-: k(kmag), kprime(kprimemag), momenta(LabelMap<Momentum, ThreeVector> {{Momentum::k1, ThreeVector()}, {Momentum::k2, ThreeVector()}, {Momentum::k3, ThreeVector()}, {Momentum::k4, ThreeVector()}, {Momentum::q, ThreeVector()}}), qmax(qlim), kernels(kern), PL(linPS), covariance(cov)
+: k(kmag), kprime(kprimemag), momenta(LabelMap<Momentum, ThreeVector> {{Momentum::k1, ThreeVector()}, {Momentum::k2, ThreeVector()}, {Momentum::k3, ThreeVector()}, {Momentum::k4, ThreeVector()}, {Momentum::q, ThreeVector()}}), qmax(qlim), kernels(kern), PL(linPS), covariance(cov), diagram(-1)
 {}
 
 } // namespace fnfast
@@ -23,8 +23,10 @@
 #include <map>
 #include <vector>
 #include <unordered_map>
+#include <mutex>
 
 #include "KernelBase.hpp"
+#include "KernelDAG.hpp"
 #include "LinearPowerSpectrumBase.hpp"
 #include "Line.hpp"
 #include "LabelMap.hpp"
@@ -42,8 +44,10 @@ class DiagramBase
       std::vector<VertexPair> _vertexpairs;                       ///< container for endpoint vertices of lines
       std::vector<Momentum> _extmomlabels;                        ///< momentum labels in the graph
       std::vector<LabelMap<Momentum, Momentum> > _perms;          ///< permutations of external momenta for the graph
+      std::vector<std::vector<int> > _permindices;                ///< permutations as index arrays into _extmomlabels
       LabelMap<Vertex, VertexType> _vertextypes;                  ///< vertex types
       LabelMap<Vertex, KernelType> _kerneltypes;                  ///< kernel types
+      bool _compiled;                                             ///< whether the vertex calls are mapped onto a KernelDAG
 
    public:
       /// base constructor, assumes all vertices are the same type and we're computing delta correlators
@@ -65,11 +69,17 @@ class DiagramBase
       std::vector<LabelMap<Momentum, Momentum> > get_perms() const { return _perms; }
 
       /// set the external momentum permutations to be used in the diagram calculation
-      void set_perms(std::vector<LabelMap<Momentum, Momentum> > perms) { _perms = perms; }
+      void set_perms(std::vector<LabelMap<Momentum, Momentum> > perms);
 
       /// returns the diagram value with the input momentum routing
       virtual double value(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const = 0;
 
+      /// register the vertex calls of the diagram in a (shared) KernelDAG, no-op for diagrams without a compiled evaluation
+      virtual void compile(KernelDAG&) {}
+
+      /// whether the diagram has been compiled (and its permutations have not changed since)
+      bool compiled() const { return _compiled; }
+
    protected:
       /// function theta(|p1| < |p2|)
       static double theta(ThreeVector p1, ThreeVector p2);
@@ -77,17 +87,50 @@ class DiagramBase
       /// computes symmetry factor
       double calc_symmetry_factor();
 
-      /// computes permutations of external momenta
-      std::vector<LabelMap<Momentum, Momentum> > calc_permutations();
+      /// computes permutations of external momenta, as index arrays into _extmomlabels
+      std::vector<std::vector<int> > calc_permutations();
+
+      /// canonical string encoding of the labeled topology under a vertex relabeling
+      std::string topology_key(const std::vector<int>& indices);
+
+      /// converts a permutation index array to a map on the momentum labels
+      LabelMap<Momentum, Momentum> perm_labelmap(const std::vector<int>& indices) const;
+
+      /// applies a permutation index array to the external momenta (mom_perm must hold all labels in mom)
+      void permute_momenta(const LabelMap<Momentum, ThreeVector>& mom, const std::vector<int>& indices, LabelMap<Momentum, ThreeVector>& mom_perm) const;
+
+      /// slot index array (see MomentumView) applying a permutation index array to the external momenta
+      void perm_slots(const std::vector<int>& indices, int* slots) const;
 
       /// factorial
       static int factorial(int n) { return (n == 0 || n == 1) ? 1 : n * factorial(n-1); }
+
+   private:
+      static std::unordered_map<std::string, std::vector<std::vector<int> > > _permcache;   ///< permutations of all topologies seen so far
+      static std::mutex _permcachemutex;                                                     ///< guards _permcache
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 // Inline Declarations
 ////////////////////////////////////////////////////////////////////////////////
 
+//------------------------------------------------------------------------------
+inline void DiagramBase::permute_momenta(const LabelMap<Momentum, ThreeVector>& mom, const std::vector<int>& indices, LabelMap<Momentum, ThreeVector>& mom_perm) const
+{
+   for (size_t i = 0; i < indices.size(); i++) {
+      mom_perm[_extmomlabels[i]] = mom[_extmomlabels[indices[i]]];
+   }
+}
+
+//------------------------------------------------------------------------------
+inline void DiagramBase::perm_slots(const std::vector<int>& indices, int* slots) const
+{
+   for (int i = 0; i < MomentumView::kNumSlots; i++) { slots[i] = i; }
+   for (size_t i = 0; i < indices.size(); i++) {
+      slots[MomentumView::slot(_extmomlabels[i])] = MomentumView::slot(_extmomlabels[indices[i]]);
+   }
+}
+
 //------------------------------------------------------------------------------
 inline double DiagramBase::theta(ThreeVector p1, ThreeVector p2)
 {
@@ -26,9 +26,29 @@ namespace fnfast {
 class DiagramOneLoop : public DiagramBase
 {
    private:
+      /// routing q -> +-q + pole of the loop momentum, compiled into a KernelDAG
+      struct LoopRouting {
+         int q;                          ///< momentum node of the routed loop momentum
+         std::vector<int> lines;         ///< momentum nodes of the loop lines
+         std::vector<int> vertices;      ///< kernel nodes of the loop vertices
+      };
+
+      /// external momentum permutation, compiled into a KernelDAG
+      struct CompiledPerm {
+         std::vector<int> extlines;          ///< momentum nodes of the external lines
+         std::vector<int> extvertices;       ///< kernel nodes of the external vertices
+         std::vector<int> poles;             ///< momentum nodes of the IR poles
+         std::vector<LoopRouting> routings;  ///< loop momentum routings, index 2 * pole + (0 for q, 1 for -q), where pole 0 is q = 0
+      };
+
       Order _order;                        ///< order of the calculation
       std::vector<Propagator> _IRpoles;    ///< IR poles
       double _qmax;                        ///< upper limit on the magnitude of the loop momentum (default is infinity)
+      std::vector<Line> _looplines;        ///< lines carrying the loop momentum
+      std::vector<Line> _extlines;         ///< lines independent of the loop momentum
+      std::vector<Vertex> _loopvertices;   ///< vertices with the loop momentum attached
+      std::vector<Vertex> _extvertices;    ///< vertices independent of the loop momentum
+      std::vector<CompiledPerm> _dagperms; ///< permutations compiled into a KernelDAG
 
    public:
       /// base constructor, assumes all vertices are the same type and we're computing delta correlators
@@ -46,11 +66,47 @@ class DiagramOneLoop : public DiagramBase
       /// returns the IR regulated diagram value with the input momentum routing
       double value_base_IRreg(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
 
+      /// returns the diagram value for a view of a flat momentum array
+      double value_base(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+      /// returns the IR regulated diagram value for a view of a flat momentum array
+      double value_base_IRreg(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
       /// returns the IR regulated diagram value, symmetrized over external momenta
       double value(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
 
+      /// register the vertex calls of the diagram in a KernelDAG
+      void compile(KernelDAG& dag);
+
+      /// returns the IR regulated diagram value, symmetrized over external momenta, from an evaluation of the KernelDAG the diagram is compiled into
+      double value(KernelDAG::Evaluation& eval, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
       /// set a cutoff on the magnitude of the loop momentum
       void set_qmax(double qmax) { _qmax = qmax; }
+      /// get the upper limit on the loop momentum
+      double qmax() const { return _qmax; }
+
+   private:
+      /// sorts lines and vertices by whether they depend on the loop momentum
+      void split_loop_dependence();
+
+      /// symmetry factor times the propagators and vertices independent of the loop momentum
+      double value_external(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+      /// propagators and vertices depending on the loop momentum
+      double value_loop(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+      /// IR regulated sum of the loop momentum dependent factors
+      double value_loop_IRreg(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+      /// compiles a loop momentum routing q -> qsign * q + pole
+      LoopRouting compile_routing(KernelDAG& dag, const int* indices, int qsign, const KernelDAG::Combination& pole) const;
+
+      /// propagators and vertices depending on the loop momentum, for a compiled routing
+      double value_loop(const LoopRouting& routing, KernelDAG::Evaluation& eval, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+      /// IR regulated sum of the loop momentum dependent factors, for a compiled permutation
+      double value_loop_IRreg(const CompiledPerm& perm, int qsign, KernelDAG::Evaluation& eval, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
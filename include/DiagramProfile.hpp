@@ -0,0 +1,131 @@
+//------------------------------------------------------------------------------
+/// \file DiagramProfile.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class DiagramProfile
+//------------------------------------------------------------------------------
+
+#ifndef DIAGRAM_PROFILE_HPP
+#define DIAGRAM_PROFILE_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace fnfast {
+
+class DiagramBase;
+
+//------------------------------------------------------------------------------
+/**
+ * \class DiagramProfile
+ *
+ * \brief per-diagram cost and variance of a loop integrand
+ *
+ * A DiagramProfile attached to a diagram set (DiagramSetBase::set_profile,
+ * or set_profile of PowerSpectrum, Bispectrum and Covariance) records, for
+ * each diagram evaluated by value_oneLoop and value_twoLoop:
+ * - the number of calls and the wall time spent in the diagram
+ * - the number of calls into the kernels it triggered (for compiled
+ *   diagrams; kernel values shared with a diagram evaluated earlier at the
+ *   same point are attributed to that diagram)
+ * - the sum and sum of squares of its weighted value w v_d, where w is the
+ *   phase space weight passed by the integrand, and the sum of its product
+ *   with the weighted total w v
+ * The contribution of diagram d to the variance of the integrand is
+ * Cov(w v_d, w v), which adds up to Var(w v) over the diagrams; the mean of
+ * w v_d estimates the diagram's share of the integral (for flat sampling).
+ * summary() prints a table after the integral returns.
+ *
+ * Recording is not thread safe: profile a single-threaded integration.  The
+ * profile is recorded in the integrand, so it must run in this process: the
+ * observables turn off Cuba's worker processes while a profile is attached,
+ * and an integrator used directly needs IntegratorBase::serial.  For the same
+ * reason the observables do not take a profiled integral from their
+ * ResultCache.  PowerSpectrum::oneLoop at a set of k is not profiled, as its
+ * k bins are different integrands.
+ */
+//------------------------------------------------------------------------------
+
+class DiagramProfile
+{
+   public:
+      /// profile of one diagram
+      struct Entry {
+         std::string name;          ///< diagram name, e.g. "T5111"
+         long calls = 0;            ///< number of evaluations
+         long kernel_calls = 0;     ///< calls into the kernels
+         double time = 0;           ///< wall time [s]
+         double sum = 0;            ///< sum of w v_d
+         double sum2 = 0;           ///< sum of (w v_d)^2
+         double sumtotal = 0;       ///< sum of w v_d times w v
+      };
+
+   private:
+      std::vector<Entry> _entries;                                   ///< diagrams in order of first evaluation
+      std::unordered_map<const DiagramBase*, size_t> _index;         ///< entry of each diagram
+      long _npoints;                                                 ///< number of phase space points
+      double _sum;                                                   ///< sum of w v
+      double _sum2;                                                  ///< sum of (w v)^2
+      std::vector<std::pair<size_t, double> > _point;                ///< w v_d of the diagrams at the current point
+      double _weight;                                                ///< w at the current point
+
+   public:
+      /// constructor
+      DiagramProfile() : _npoints(0), _sum(0), _sum2(0), _weight(1) {}
+      /// destructor
+      virtual ~DiagramProfile() {}
+
+      /// clears all records
+      void reset();
+
+      /// starts a phase space point with weight w
+      void begin_point(double weight);
+
+      /// records the evaluation of a diagram at the current point
+      void add(const DiagramBase* diagram, const std::string& name, double value, double time, int kernel_calls);
+
+      /// ends the current point
+      void end_point();
+
+      /// profiles of the diagrams
+      const std::vector<Entry>& entries() const { return _entries; }
+
+      /// number of phase space points
+      long npoints() const { return _npoints; }
+
+      /// variance of the weighted integrand w v
+      double variance() const;
+
+      /// contribution Cov(w v_d, w v) of a diagram to the variance of the integrand
+      double variance(const Entry& entry) const;
+
+      /// table of the diagram profiles
+      std::string summary() const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+inline void DiagramProfile::begin_point(double weight)
+{
+   _weight = weight;
+   _point.clear();
+}
+
+} // namespace fnfast
+
+#endif // DIAGRAM_PROFILE_HPP
@@ -19,6 +19,12 @@
 #ifndef DIAGRAM_SET_BASE_HPP
 #define DIAGRAM_SET_BASE_HPP
 
+#include <chrono>
+#include <limits>
+#include <string>
+#include <unordered_map>
+
+#include "DiagramProfile.hpp"
 #include "DiagramTree.hpp"
 #include "DiagramOneLoop.hpp"
 #include "DiagramTwoLoop.hpp"
@@ -33,6 +39,9 @@ class DiagramSetBase
       std::vector<DiagramOneLoop*> _oneLoop;       ///< one loop diagrams
       std::vector<DiagramTwoLoop*> _twoLoop;       ///< two loop diagrams
       std::vector<Momentum> _extmomlabels;         ///< external momentum labels in the graph
+      KernelDAG _dag;                              ///< vertex kernel calls shared between the diagrams
+      std::unordered_map<const DiagramBase*, std::string> _names;    ///< graph name of each diagram
+      DiagramProfile* _profile;                    ///< per-diagram profile of the loop integrands (nullptr if off)
 
    public:
       /// constructor
@@ -55,17 +64,63 @@ class DiagramSetBase
       /// get the two loop diagrams
       std::vector<DiagramTwoLoop*> twoLoop() const { return _twoLoop; }
 
+      /// get the DAG of vertex kernel calls of the diagrams
+      const KernelDAG& dag() const { return _dag; }
+
+      /// graph name of a diagram in the set, e.g. "T5111"
+      std::string name(const DiagramBase* diagram) const;
+
+      /// attach a profile recording the per-diagram cost and variance of the loop integrands, nullptr to detach
+      void set_profile(DiagramProfile* profile) { _profile = profile; }
+
+      /// the attached profile
+      DiagramProfile* profile() const { return _profile; }
+
+      /*
+       * map the vertex calls of all diagrams onto a single KernelDAG, so that
+       * a kernel call shared between diagrams and permutations is evaluated
+       * once per phase space point; called at the end of the constructors
+       * of the derived sets (and again after changing any diagram's permutations)
+       */
+      void compile();
+
       /// get the value of the tree level diagrams
       double value_tree(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL) const;
 
-      /// get the value of the one loop diagrams
-      double value_oneLoop(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL) const;
+      /// get the value of the one loop diagrams (weight is the phase space weight of the point, only used by the profile)
+      double value_oneLoop(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL, double weight = 1) const;
+
+      /// get the value of the one loop diagrams, not recorded in the profile
+      double value_oneLoop_unprofiled(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+      /// names of the one loop diagrams, in the order of oneLoop()
+      std::vector<std::string> names_oneLoop() const;
+
+      /// values of each of the one loop diagrams, in the order of oneLoop(), sharing the kernel evaluations
+      void values_oneLoop(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, double* values) const;
+
+      /// value of a single one loop diagram, by its position in oneLoop()
+      double value_oneLoop_diagram(int diagram, const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
 
-      /// get the value of the two loop diagrams
-      double value_twoLoop(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL) const;
+      /// get the value of the two loop diagrams (weight is the phase space weight of the point, only used by the profile)
+      double value_twoLoop(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL, double weight = 1) const;
 
       /// set the loop momentum restriction for all loop diagrams
       void set_qmax(double qmax);
+      /// upper limit on the loop momenta of the loop diagrams (infinity if none are set)
+      double qmax() const;
+
+   protected:
+      /// set the graph names of the diagrams from the map of graph labels to diagrams
+      template <class Graphs>
+      void set_names(const LabelMap<Graphs, DiagramBase*>& diagrams);
+
+   private:
+      /// value of the one loop diagrams, recorded in the profile
+      double profile_oneLoop(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, double weight) const;
+
+      /// value of the two loop diagrams, recorded in the profile
+      double profile_twoLoop(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, double weight) const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -74,31 +129,109 @@ class DiagramSetBase
 
 //------------------------------------------------------------------------------
 inline DiagramSetBase::DiagramSetBase(Order order)
-: _order(order) {}
+: _order(order), _profile(nullptr) {}
+
+//------------------------------------------------------------------------------
+inline std::string DiagramSetBase::name(const DiagramBase* diagram) const
+{
+   auto it = _names.find(diagram);
+   return (it != _names.end()) ? it->second : "";
+}
+
+//------------------------------------------------------------------------------
+template <class Graphs>
+inline void DiagramSetBase::set_names(const LabelMap<Graphs, DiagramBase*>& diagrams)
+{
+   for (auto graph : diagrams.labels()) {
+      _names[diagrams[graph]] = graph_name(graph);
+   }
+}
+
+//------------------------------------------------------------------------------
+inline void DiagramSetBase::compile()
+{
+   _dag = KernelDAG();
+   for (auto diagram : _tree) {
+      diagram->compile(_dag);
+   }
+   for (auto diagram : _oneLoop) {
+      diagram->compile(_dag);
+   }
+   for (auto diagram : _twoLoop) {
+      diagram->compile(_dag);
+   }
+   _dag.group();
+}
 
 //------------------------------------------------------------------------------
 inline double DiagramSetBase::value_tree(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL) const
 {
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   KernelDAG::Evaluation eval(_dag, flatmom);
    double value = 0;
    for (auto diagram : _tree) {
-      value += diagram->value(mom, kernels, PL);
+      value += diagram->compiled() ? diagram->value(eval, kernels, PL) : diagram->value(mom, kernels, PL);
    }
    return value;
 }
 
 //------------------------------------------------------------------------------
-inline double DiagramSetBase::value_oneLoop(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL) const
+inline double DiagramSetBase::value_oneLoop(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL, double weight) const
+{
+   if (_profile) { return profile_oneLoop(mom, kernels, PL, weight); }
+   return value_oneLoop_unprofiled(mom, kernels, PL);
+}
+
+//------------------------------------------------------------------------------
+inline double DiagramSetBase::value_oneLoop_unprofiled(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
 {
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   KernelDAG::Evaluation eval(_dag, flatmom);
    double value = 0;
    for (auto diagram : _oneLoop) {
-      value += diagram->value(mom, kernels, PL);
+      value += diagram->compiled() ? diagram->value(eval, kernels, PL) : diagram->value(mom, kernels, PL);
    }
    return value;
 }
 
 //------------------------------------------------------------------------------
-inline double DiagramSetBase::value_twoLoop(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL) const
+inline std::vector<std::string> DiagramSetBase::names_oneLoop() const
+{
+   std::vector<std::string> names;
+   for (auto diagram : _oneLoop) {
+      names.push_back(name(diagram));
+   }
+   return names;
+}
+
+//------------------------------------------------------------------------------
+inline void DiagramSetBase::values_oneLoop(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, double* values) const
 {
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   KernelDAG::Evaluation eval(_dag, flatmom);
+   for (size_t i = 0; i < _oneLoop.size(); i++) {
+      DiagramOneLoop* diagram = _oneLoop[i];
+      values[i] = diagram->compiled() ? diagram->value(eval, kernels, PL) : diagram->value(mom, kernels, PL);
+   }
+}
+
+//------------------------------------------------------------------------------
+inline double DiagramSetBase::value_oneLoop_diagram(int diagram, const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   KernelDAG::Evaluation eval(_dag, flatmom);
+   DiagramOneLoop* oneLoop = _oneLoop[diagram];
+   return oneLoop->compiled() ? oneLoop->value(eval, kernels, PL) : oneLoop->value(mom, kernels, PL);
+}
+
+//------------------------------------------------------------------------------
+inline double DiagramSetBase::value_twoLoop(const LabelMap<Momentum, ThreeVector>& mom, LabelMap<Vertex, KernelBase*> kernels, LinearPowerSpectrumBase* PL, double weight) const
+{
+   if (_profile) { return profile_twoLoop(mom, kernels, PL, weight); }
    double value = 0;
    for (auto diagram : _twoLoop) {
       value += diagram->value(mom, kernels, PL);
@@ -106,6 +239,50 @@ inline double DiagramSetBase::value_twoLoop(const LabelMap<Momentum, ThreeVector
    return value;
 }
 
+//------------------------------------------------------------------------------
+inline double DiagramSetBase::profile_oneLoop(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, double weight) const
+{
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   KernelDAG::Evaluation eval(_dag, flatmom);
+   _profile->begin_point(weight);
+   double value = 0;
+   for (auto diagram : _oneLoop) {
+      int nkernelcalls = eval.nkernel_calls();
+      auto start = std::chrono::steady_clock::now();
+      double diagramvalue = diagram->compiled() ? diagram->value(eval, kernels, PL) : diagram->value(mom, kernels, PL);
+      double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      _profile->add(diagram, name(diagram), diagramvalue, time, eval.nkernel_calls() - nkernelcalls);
+      value += diagramvalue;
+   }
+   _profile->end_point();
+   return value;
+}
+
+//------------------------------------------------------------------------------
+inline double DiagramSetBase::profile_twoLoop(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, double weight) const
+{
+   // the two loop diagrams are not compiled, so there is no kernel count
+   _profile->begin_point(weight);
+   double value = 0;
+   for (auto diagram : _twoLoop) {
+      auto start = std::chrono::steady_clock::now();
+      double diagramvalue = diagram->value(mom, kernels, PL);
+      double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      _profile->add(diagram, name(diagram), diagramvalue, time, 0);
+      value += diagramvalue;
+   }
+   _profile->end_point();
+   return value;
+}
+
+//------------------------------------------------------------------------------
+inline double DiagramSetBase::qmax() const
+{
+   if (!_oneLoop.empty()) { return _oneLoop[0]->qmax(); }
+   return std::numeric_limits<double>::infinity();
+}
+
 //------------------------------------------------------------------------------
 inline void DiagramSetBase::set_qmax(double qmax)
 {
@@ -26,7 +26,9 @@ namespace fnfast {
 class DiagramTree : public DiagramBase
 {
    private:
-      Order _order;     ///< order of the calculation
+      Order _order;                    ///< order of the calculation
+      std::vector<int> _daglines;      ///< momentum nodes of the lines, for each permutation
+      std::vector<int> _dagvertices;   ///< kernel nodes of the vertices, for each permutation
 
    public:
       /// base constructor, assumes all vertices are the same type and we're computing delta correlators
@@ -40,6 +42,12 @@ class DiagramTree : public DiagramBase
 
       /// returns the diagram value with the input momentum routing
       double value(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+      /// register the vertex calls of the diagram in a KernelDAG
+      void compile(KernelDAG& dag);
+
+      /// returns the diagram value from an evaluation of the KernelDAG the diagram is compiled into
+      double value(KernelDAG::Evaluation& eval, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
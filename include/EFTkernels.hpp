@@ -24,10 +24,17 @@
 #include <map>
 #include <string>
 #include <sstream>
+#include <stdexcept>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <utility>
 
 #include "KernelBase.hpp"
+#include "LabelMap.hpp"
 #include "SPTkernels.hpp"
 #include "ThreeVector.hpp"
+#include "ThreeVectorBatch.hpp"
 
 namespace fnfast {
 
@@ -43,30 +50,33 @@ namespace fnfast {
 
 class EFTcoefficients {
     public:
-        //default constructor: initialize all coefficients to zero
-        EFTcoefficients(){ for(unsigned int i=0; i<_labels.size(); i++) _coeff_value[_labels[i]]=0;}
-        virtual ~EFTcoefficients(){}
-
         //Labels for counterterm coefficients
         enum Labels {cs,c1,c2,c3,t2,t3,d1,d2,d3,d4,d5,d6};
+        static const int kNumCoefficients = 12;   ///< number of labels
+
+        //default constructor: initialize all coefficients to zero
+        EFTcoefficients(){ _coeff_value.fill(0);}
+        virtual ~EFTcoefficients(){}
 
         //Input/read values
         double& operator[](EFTcoefficients::Labels label) {return _coeff_value[label];}
+        double operator[](EFTcoefficients::Labels label) const {return _coeff_value[label];}
+        double value(EFTcoefficients::Labels label) const {return _coeff_value[label];}
 
-        //Alternative way of inputing values
-        void set_coefficients(std::map<EFTcoefficients::Labels, double> coeff_value) {_coeff_value=coeff_value;}
+        //Alternative way of inputing values, coefficients not in the map are set to zero
+        void set_coefficients(std::map<EFTcoefficients::Labels, double> coeff_value) { _coeff_value.fill(0); for(auto& coeff : coeff_value) _coeff_value[coeff.first]=coeff.second;}
 
         //General description
-        std::string description();
+        std::string description() const;
+
+        //Name of a coefficient
+        static const char* name(EFTcoefficients::Labels label) { static const char* names[kNumCoefficients] = {"cs","c1","c2","c3","t2","t3","d1","d2","d3","d4","d5","d6"}; return names[label];}
 
         //Print coefficient values
-        void print_all_coefficients(){ for(unsigned int i=0; i<_labels.size(); i++) std::cout<<_labels_names[_labels[i]]<<" = "<<_coeff_value[_labels[i]]<<std::endl;}
+        void print_all_coefficients() const { for(int i=0; i<kNumCoefficients; i++) std::cout<<name(static_cast<Labels>(i))<<" = "<<_coeff_value[i]<<std::endl;}
 
     private:
-        std::map<EFTcoefficients::Labels, double> _coeff_value;
-
-        std::vector<EFTcoefficients::Labels> _labels = {cs,c1,c2,c3,t2,t3,d1,d2,d3,d4,d5,d6};
-        std::vector<std::string> _labels_names = {"cs","c1","c2","c3","t2","t3","d1","d2","d3","d4","d5","d6"};
+        std::array<double, kNumCoefficients> _coeff_value;   ///< values, indexed by label
 };
 
 //------------------------------------------------------------------------------
@@ -75,16 +85,22 @@ class EFTcoefficients {
 
 class EFTkernels : public KernelBase {
     public:
-        EFTkernels(){}
-        EFTkernels(EFTcoefficients& coefficients): _coefficients(&coefficients) {}
+        EFTkernels() {set_coefficients(EFTcoefficients());}
+        EFTkernels(const EFTcoefficients& coefficients) {set_coefficients(coefficients);}
 
-        void set_coefficients(EFTcoefficients& coefficients) {_coefficients=&coefficients;}
+        //The kernels own a snapshot of the coefficients: later changes to the input
+        //coefficients have no effect until set_coefficients is called again.
+        //The evaluation only reads the snapshot (and the SPT kernels, see SPTkernels),
+        //so one EFTkernels object can be evaluated from several threads at once,
+        //as long as set_coefficients is not called at the same time.
+        void set_coefficients(const EFTcoefficients& coefficients);
+        const EFTcoefficients& coefficients() const {return _coefficients;}
 
         //Recursion coefficients
-        double cF_E(int n);  ///< F-kernels, with theta-Euler-equation operators
-        double cG_E(int n);  ///< G-kernels, with theta-Euler-equation operators
-        double cF_C(int n);  ///< F-kernels, with Continuity-equation operators
-        double cG_C(int n);  ///< G-kernels, with Continuity-equation operators
+        double cF_E(int n) const;  ///< F-kernels, with theta-Euler-equation operators
+        double cG_E(int n) const;  ///< G-kernels, with theta-Euler-equation operators
+        double cF_C(int n) const;  ///< F-kernels, with Continuity-equation operators
+        double cG_C(int n) const;  ///< G-kernels, with Continuity-equation operators
 
         double alpha(const ThreeVector& p1, const ThreeVector& p2) {return _sptkernels.alpha(p1,p2);}      ///< kernel function alpha
         double beta(const ThreeVector& p1, const ThreeVector& p2) {return _sptkernels.beta(p1,p2);}        ///< kernel function beta
@@ -92,6 +108,11 @@ class EFTkernels : public KernelBase {
         ThreeVector alphaOmega(const ThreeVector& p1, const ThreeVector& p2);   ///< vorticity kernel function alpha
         ThreeVector betaOmega(const ThreeVector& p1, const ThreeVector& p2);    ///< vorticity kernel function beta
 
+        DoubleBatch alpha(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2) {return _sptkernels.alpha(p1,p2);}     ///< kernel function alpha, lane by lane
+        DoubleBatch beta(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2) {return _sptkernels.beta(p1,p2);}       ///< kernel function beta, lane by lane
+        ThreeVectorBatch alphaOmega(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2);  ///< vorticity kernel function alpha, lane by lane
+        ThreeVectorBatch betaOmega(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2);   ///< vorticity kernel function beta, lane by lane
+
         double Fn(const std::vector<ThreeVector>& p);                  ///< EFT kernel Fn (q1, ..., qn)
         double Gn(const std::vector<ThreeVector>& p);                  ///< EFT kernel Gn (q1, ..., qn)
 
@@ -99,27 +120,127 @@ class EFTkernels : public KernelBase {
         double Gn_sym(const std::vector<ThreeVector>& p);              ///< symmetrized EFT kernel Gn (q1, ..., qn)
 
     private:
-        EFTcoefficients* _coefficients;
+        EFTcoefficients _coefficients;
         SPTkernels _sptkernels;
 
+        //Coefficients arranged for the contractions with the shapes, set by set_coefficients
+        double _cs;        ///< cs
+        double _c[3];      ///< c1, c2, c3
+        double _t[3];      ///< 0, t2, t3
+        double _d[6];      ///< d1, ..., d6
+
+        //Unsymmetrized and symmetrized Fn, Gn (n <= 3) of the momenta p[0], ..., p[n-1], computed together
+        void _FnGn(const ThreeVector* p, int n, double& Fnval, double& Gnval);
+        void _FnGn_sym(const ThreeVector* p, int n, double& Fnval, double& Gnval);
+
         //EFT operators/shapes and stress-tensor
-        std::vector<ThreeVector> _LO_shapes(ThreeVector p);
-        std::vector<ThreeVector> _NLO_shapes(ThreeVector p1, ThreeVector p2);
-        std::vector<ThreeVector> _NNLO_shapes(ThreeVector p1, ThreeVector p2, ThreeVector p3);
-        ThreeVector _tau(const std::vector<ThreeVector>& p);
+        //the SPT kernels of the subsets of the momenta are passed in (see _FnGn)
+        void _NLO_shapes(const ThreeVector& p1, const ThreeVector& p2, ThreeVector* shapes);
+        void _NNLO_shapes(const ThreeVector& p1, const ThreeVector& p2, const ThreeVector& p3, ThreeVector* shapes);
+        ThreeVector _tau(const ThreeVector& p1);
+        ThreeVector _tau(const ThreeVector& p1, const ThreeVector& p2, double F12);
+        ThreeVector _tau(const ThreeVector& p1, const ThreeVector& p2, const ThreeVector& p3, double F123, double F23, double F12, double G23, double G12);
 
         //Vorticity
-        ThreeVector _omega(const std::vector<ThreeVector>& p);
+        ThreeVector _omega(const ThreeVector& p1, const ThreeVector& p2, double F12);
 
         //Helper function
-        //Returns the dot product between a vector of coefficients and a vector of shapes
-        ThreeVector _dot_product(std::vector<double> a, std::vector<ThreeVector> b);
+        //Returns the dot product between an array of coefficients and an array of shapes
+        ThreeVector _dot_product(const double* a, const ThreeVector* b, int n);
+};
+
+//------------------------------------------------------------------------------
+//Decomposition of an EFT observable in the counterterm coefficients
+//
+//The EFT diagrams have a single EFT vertex, and the EFT kernels are linear in
+//the coefficients, so an EFT observable is sum_i c_i O_i with O_i the observable
+//for c_i = 1 and all other coefficients zero.  decompose() computes the O_i once,
+//after which the observable for any set of coefficients is a dot product, e.g.
+//
+//   EFTbasis basis = PS.treeEFT_basis(k, kernels, &PL);
+//   double PSresultEFT = basis(coeffs);
+//
+//With EFT kernels at two or more vertices the observable is quadratic or higher
+//in the coefficients, and without any it does not depend on them, so decompose()
+//throws std::invalid_argument unless exactly one vertex has EFT kernels.
+
+class EFTbasis {
+    public:
+        EFTbasis() {_values.fill(0); _errors.fill(0);}
+        virtual ~EFTbasis() {}
+
+        //Contribution (and its error) of a single coefficient, for unit value
+        void set(EFTcoefficients::Labels label, double value, double error = 0) {_values[label]=value; _errors[label]=error;}
+        double value(EFTcoefficients::Labels label) const {return _values[label];}
+        double error(EFTcoefficients::Labels label) const {return _errors[label];}
+
+        //Observable for a set of coefficients
+        double operator()(const EFTcoefficients& coefficients) const;
+        //Error for a set of coefficients: sum_i |c_i| error_i, since the O_i are
+        //integrated with the same random numbers and their errors are correlated
+        double error(const EFTcoefficients& coefficients) const;
+
+        //Computes the basis: observable(kernels) returns (value, error) with the
+        //EFT kernels in the input map replaced by kernels with unit coefficients
+        template <typename Observable>
+        static EFTbasis decompose(const LabelMap<Vertex, KernelBase*>& kernels, Observable observable);
+
+    private:
+        std::array<double, EFTcoefficients::kNumCoefficients> _values;   ///< O_i
+        std::array<double, EFTcoefficients::kNumCoefficients> _errors;   ///< errors on the O_i
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 // Inline Declarations
 ////////////////////////////////////////////////////////////////////////////////
 
+//------------------------------------------------------------------------------
+inline double EFTbasis::operator()(const EFTcoefficients& coefficients) const
+{
+   double value = 0;
+   for (int i = 0; i < EFTcoefficients::kNumCoefficients; i++) {
+      value += coefficients.value(static_cast<EFTcoefficients::Labels>(i)) * _values[i];
+   }
+   return value;
+}
+
+//------------------------------------------------------------------------------
+inline double EFTbasis::error(const EFTcoefficients& coefficients) const
+{
+   double error = 0;
+   for (int i = 0; i < EFTcoefficients::kNumCoefficients; i++) {
+      error += std::abs(coefficients.value(static_cast<EFTcoefficients::Labels>(i))) * _errors[i];
+   }
+   return error;
+}
+
+//------------------------------------------------------------------------------
+template <typename Observable>
+EFTbasis EFTbasis::decompose(const LabelMap<Vertex, KernelBase*>& kernels, Observable observable)
+{
+   // vertices with EFT kernels
+   std::vector<Vertex> EFTvertices;
+   for (auto vertex : kernels.labels()) {
+      if (dynamic_cast<EFTkernels*>(kernels[vertex]) != nullptr) { EFTvertices.push_back(vertex); }
+   }
+   if (EFTvertices.size() != 1) {
+      throw std::invalid_argument("EFTbasis::decompose: the observable is linear in the coefficients only with EFT kernels at exactly one vertex");
+   }
+
+   EFTbasis basis;
+   for (int i = 0; i < EFTcoefficients::kNumCoefficients; i++) {
+      EFTcoefficients::Labels label = static_cast<EFTcoefficients::Labels>(i);
+      EFTcoefficients unit;
+      unit[label] = 1;
+      EFTkernels unitkernels(unit);
+      LabelMap<Vertex, KernelBase*> unitmap = kernels;
+      for (auto vertex : EFTvertices) { unitmap[vertex] = &unitkernels; }
+      std::pair<double, double> result = observable(unitmap);
+      basis.set(label, result.first, result.second);
+   }
+   return basis;
+}
+
 } // namespace fnfast
 
 #endif // EFT_KERNELS_HPP
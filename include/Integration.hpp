@@ -19,6 +19,12 @@
 #ifndef INTEGRATION_HPP
 #define INTEGRATION_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
 #include "cuba.h"
 
 namespace fnfast {
@@ -41,30 +47,276 @@ struct IntegralResult
    IntegralResult(double res, double err, double p) : result(res), error(err), prob(p) {}
 };
 
+/*
+ * combination of independent estimates of an integral, e.g. runs with
+ * different seeds: the inverse-variance weighted mean, with error
+ * (sum 1/error^2)^(-1/2); prob is the chi^2 probability that the estimates
+ * scatter less than observed about the mean, as in Cuba, from the
+ * Wilson-Hilferty approximation.  Estimates with error 0 are exact, and if
+ * there are any the result is their mean with error 0.
+ */
+IntegralResult combine(const std::vector<IntegralResult>& estimates);
+
 //------------------------------------------------------------------------------
 /**
- * \struct VEGASintegrator
+ * \struct IntegralResults
  *
- * \brief Defines a simple interface to the Cuba VEGAS integration routine
+ * \brief Defines container to hold the results of an integral with several components.
+ *
+ * Contains the result, error, and probability that the error is not robust of
+ * each component; component i as an IntegralResult is (*this)[i]
+ */
+//------------------------------------------------------------------------------
+struct IntegralResults
+{
+   std::vector<double> result;      ///< result of each component
+   std::vector<double> error;       ///< error of each component
+   std::vector<double> prob;        ///< probability that the error of each component is NOT a reliable estimate
+
+   IntegralResults(int ncomp = 0) : result(ncomp, 0), error(ncomp, 0), prob(ncomp, 0) {}
+
+   /// number of components
+   size_t size() const { return result.size(); }
+
+   /// component i
+   IntegralResult operator[](size_t i) const { return IntegralResult(result[i], error[i], prob[i]); }
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \struct ErrorTarget
+ *
+ * \brief Defines the error target of an integral tied to the observable
+ *
+ * An integral I is converged when its error is below
+ *    max(absolute, relative |reference + I|)
+ * where the reference is the known part of the observable, e.g. the tree
+ * level for a one loop integral, and the absolute error can be taken from
+ * the survey errors.
+ */
+//------------------------------------------------------------------------------
+struct ErrorTarget
+{
+   double absolute;     ///< absolute error
+   double relative;     ///< error relative to the observable reference + I
+   double reference;    ///< known part of the observable
+
+   ErrorTarget(double abs = 0, double rel = 1e-3, double ref = 0) : absolute(abs), relative(rel), reference(ref) {}
+
+   /// target error for the integral value I
+   double error(double I) const { return std::max(absolute, relative * std::abs(reference + I)); }
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \enum class GridMode
  *
- * Returns the integration result into a IntegralResult container
+ * \brief how the diagrams of a loop integral are sampled
+ *
+ * - kShared: one integration with a component per diagram, so all diagrams
+ *   are sampled at the same points (sharing their kernel evaluations) and
+ *   each component must converge
+ * - kSeparate: one integration per diagram, each with its own adapted grid
  */
 //------------------------------------------------------------------------------
-struct VEGASintegrator
+enum class GridMode : int {
+   kShared,
+   kSeparate
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \struct DiagramIntegrals
+ *
+ * \brief Defines container to hold the integrals of the diagrams of a loop integral
+ *
+ * Contains the diagram names, the integral of each diagram and of their sum
+ */
+//------------------------------------------------------------------------------
+struct DiagramIntegrals
+{
+   std::vector<std::string> names;           ///< diagram names
+   std::vector<IntegralResult> diagrams;     ///< integral of each diagram
+   IntegralResult total;                     ///< integral of the sum of the diagrams
+
+   DiagramIntegrals() : total(0, 0, 0) {}
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \brief integration method of the loop integrals
+ *
+ * - kVEGAS: adaptive Monte Carlo, the Cuba VEGAS routine
+ * - kLattice: randomly shifted rank-1 lattice rule (QMCintegrator)
+ * - kSobol: scrambled Sobol sequence (QMCintegrator)
+ */
+//------------------------------------------------------------------------------
+enum class IntegrationMethod : int {
+   kVEGAS,
+   kLattice,
+   kSobol
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \struct IntegratorBase
+ *
+ * \brief Base class of the integrators of the loop integrands
+ *
+ * Integrands have the Cuba signature integrand_t and are integrated over the
+ * unit hypercube.  Implementations integrate an integrand with ncomp
+ * components; the single component and the diagram integrals are built on it.
+ */
+//------------------------------------------------------------------------------
+struct IntegratorBase
 {
    int ndim;                  ///< number of dimensions in the integral
    double epsrel;             ///< relative accuracy desired
+   double epsabs;             ///< absolute accuracy desired, converged when either is reached
    int maxeval;               ///< maximum number of integrand evaluations
+   std::string statefile;     ///< checkpoint of the integration state, none if empty
+   bool retain;               ///< keep the statefile when the integration ends, so that a call with a tighter target continues it
+   bool serial;               ///< evaluate the integrand in this process only, e.g. when it records a DiagramProfile
+
+   /// constructor
+   IntegratorBase(int numdim, double err, int neval) : ndim(numdim), epsrel(err), epsabs(0), maxeval(neval), retain(false), serial(false) {}
+   /// destructor
+   virtual ~IntegratorBase() {}
+
+   /// integrator of a given method and random number seed, other settings at their defaults
+   static std::unique_ptr<IntegratorBase> create(IntegrationMethod method, int numdim, int seed, double err = 1e-3, int neval = 250000, const std::string& state = "");
+
+   /// integration function
+   IntegralResult integrate(integrand_t integrand, void * userdata);
+
+   /// integration of an integrand with ncomp components, converged in each component
+   virtual IntegralResults integrate(integrand_t integrand, void * userdata, int ncomp) = 0;
+
+   /// method and settings, e.g. for cache keys
+   virtual std::string settings() const = 0;
+
+   /*
+    * integration to an error target: with a reference the target depends on
+    * the result, so the integral is run (up to 3 passes) to the absolute
+    * target of the previous result until that target is met or maxeval is
+    * exhausted; each pass continues the previous one from its retained
+    * statefile (a temporary file if none is set), so no samples are thrown
+    * away and maxeval bounds the evaluations of all passes together;
+    * epsrel, epsabs and statefile are restored afterwards
+    */
+   IntegralResult integrate(integrand_t integrand, void * userdata, const ErrorTarget& target);
+
+   /*
+    * integration of the diagrams of a loop integrand, whose diagram selector
+    * is *diagram: for *diagram = -1 the integrand fills the total in ff[0] and
+    * the diagrams in ff[1..n], for *diagram = i it fills diagram i in ff[0];
+    * with GridMode::kSeparate the errors of the total add in quadrature
+    */
+   DiagramIntegrals integrate_diagrams(integrand_t integrand, void * userdata, int* diagram, const std::vector<std::string>& names, GridMode mode);
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \struct VEGASintegrator
+ *
+ * \brief Defines a simple interface to the Cuba VEGAS integration routine
+ *
+ * Returns the integration result into a IntegralResult container.  The seed
+ * selects the Ranlux random numbers, seed 0 the Sobol quasi-random numbers,
+ * so that runs with different seeds are independent and can be combined
+ * (see combine).  With a statefile, Cuba saves its state after each iteration and an interrupted
+ * integration resumes from it; the file is removed when the integration ends,
+ * unless retain is set, when an integration with the same statefile and a
+ * tighter epsrel or epsabs continues it.
+ * Cuba evaluates the integrand in forked worker processes; with serial they
+ * are turned off (cubacores(0, 0)) for the integration and Cuba's defaults,
+ * CUBACORES or the number of cores, restored afterwards.
+ */
+//------------------------------------------------------------------------------
+struct VEGASintegrator: public IntegratorBase
+{
    int nstart;                ///< number of initial integrand evaluations
    int nincrease;             ///< number of integrand evaluations to increment by
    int nbatch;                ///< batch size for PS point sampling
+   int seed;                  ///< random number seed
 
    /// constructor
-   VEGASintegrator(int numdim, double err = 1e-3, int neval = 250000, int numstart = 1000, int numincrease = 1000, int numbatch = 1000)
-   : ndim(numdim), epsrel(err), maxeval(neval), nstart(numstart), nincrease(numincrease), nbatch(numbatch) {}
+   VEGASintegrator(int numdim, double err = 1e-3, int neval = 250000, int numstart = 1000, int numincrease = 1000, int numbatch = 1000, int rngseed = 37)
+   : IntegratorBase(numdim, err, neval), nstart(numstart), nincrease(numincrease), nbatch(numbatch), seed(rngseed) {}
 
-   /// integration function
-   IntegralResult integrate(integrand_t integrand, void * userdata);
+   using IntegratorBase::integrate;
+
+   /// integration of an integrand with ncomp components, converged in each component
+   IntegralResults integrate(integrand_t integrand, void * userdata, int ncomp);
+
+   /// method and settings
+   std::string settings() const;
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \struct QMCintegrator
+ *
+ * \brief Randomized quasi-Monte Carlo integration
+ *
+ * QMCintegrator(int ndim, IntegrationMethod rule, int seed, double epsrel, int maxeval, int nstart, int nshifts)
+ *
+ * The integral is estimated by nshifts independent randomizations of a point
+ * set of n = 2^m points:
+ * - kLattice: the rank-1 lattice x_i = {phi_2(i) z + Delta} with a random
+ *   shift Delta, phi_2 the radical inverse in base 2, so that the first 2^m
+ *   points form a lattice for each m; the points are mapped by the tent
+ *   (baker's) transform, which makes the lattice rule converge at close to
+ *   1/n for smooth integrands that are not periodic
+ * - kSobol: the Sobol sequence with a random linear (Matousek) scrambling and
+ *   a random digital shift
+ * Each randomization gives an unbiased estimate; the result is their mean and
+ * the error its standard error.  n starts at nstart (rounded up to a power of
+ * 2) and doubles, extending each point set, until every component has
+ * error <= max(epsabs, epsrel |result|) or the next step would exceed maxeval evaluations.
+ * prob is 0 if converged and 1 otherwise.
+ *
+ * The randomizations are seeded by (seed, shift) alone, so sum() over ranges
+ * of points and shifts can be split across processes and the sums combined.
+ *
+ * With a statefile, the sums and the points reached by each randomization
+ * are saved (by an atomic rename) after each randomization extends its
+ * points, and an interrupted integration with the same point sets (rule,
+ * ndim, seed, nstart, nshifts, ncomp) resumes from them, also with changed
+ * epsrel, epsabs or maxeval; the file is removed when the integration ends,
+ * unless retain is set.
+ * The lattice generating vector and the Sobol direction numbers support up
+ * to 12 dimensions.
+ */
+//------------------------------------------------------------------------------
+struct QMCintegrator: public IntegratorBase
+{
+   IntegrationMethod rule;    ///< kLattice or kSobol
+   int seed;                  ///< random number seed of the randomizations
+   int nstart;                ///< initial number of points per randomization
+   int nshifts;               ///< number of independent randomizations
+
+   static const int kMaxDim = 12;     ///< maximum number of dimensions
+
+   /// constructor
+   QMCintegrator(int numdim, IntegrationMethod qmcrule = IntegrationMethod::kLattice, int rngseed = 37, double err = 1e-3, int neval = 250000, int numstart = 512, int numshifts = 16);
+
+   using IntegratorBase::integrate;
+
+   /// integration of an integrand with ncomp components, converged in each component
+   IntegralResults integrate(integrand_t integrand, void * userdata, int ncomp);
+
+   /// method and settings
+   std::string settings() const;
+
+   /// adds the integrand summed over points [begin, end) of randomization shift to sums[0..ncomp)
+   void sum(integrand_t integrand, void * userdata, int ncomp, int shift, long begin, long end, double* sums) const;
+
+   /// saves the points n of the current step, the points reached and the sums of each randomization to the statefile
+   void save_state(int ncomp, long n, const std::vector<long>& reached, const std::vector<double>& sums) const;
+
+   /// loads a state saved for the same point sets, false if there is none
+   bool load_state(int ncomp, long& n, std::vector<long>& reached, std::vector<double>& sums) const;
 };
 
 } // namespace fnfast
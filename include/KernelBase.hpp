@@ -35,6 +35,11 @@ namespace fnfast {
  *
  * Defines the interface functions shared between kernels.
  * The symmetrization over kernels is defined in the base class.
+ *
+ * sym_subsets evaluates Fn_sym and Gn_sym on several subsets of a shared
+ * pool of momenta; the base class implementation calls Fn_sym and Gn_sym
+ * on each subset, recursive kernels can share the work between subsets and
+ * say so with shares_subsets.
  */
 //------------------------------------------------------------------------------
 class KernelBase
@@ -42,8 +47,32 @@ class KernelBase
    public:
       virtual double Fn_sym(const std::vector<ThreeVector>& p) = 0;    ///< symmetrized kernel Fn
       virtual double Gn_sym(const std::vector<ThreeVector>& p) = 0;    ///< symmetrized kernel Gn
+
+      /// symmetrized kernels Fn, Gn on each subset (indices into p, without repeats) of the momentum pool p
+      virtual void sym_subsets(const std::vector<ThreeVector>& p, const std::vector<std::vector<int> >& subsets, std::vector<double>& Fn, std::vector<double>& Gn);
+
+      /// whether sym_subsets costs little more than the kernels of the whole pool, false for the base class implementation
+      virtual bool shares_subsets() const { return false; }
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+inline void KernelBase::sym_subsets(const std::vector<ThreeVector>& p, const std::vector<std::vector<int> >& subsets, std::vector<double>& Fn, std::vector<double>& Gn)
+{
+   Fn.clear();
+   Gn.clear();
+   std::vector<ThreeVector> psubset;
+   for (auto& subset : subsets) {
+      psubset.clear();
+      for (auto index : subset) { psubset.push_back(p[index]); }
+      Fn.push_back(Fn_sym(psubset));
+      Gn.push_back(Gn_sym(psubset));
+   }
+}
+
 } // namespace fnfast
 
 #endif // KERNEL_BASE_HPP
@@ -0,0 +1,210 @@
+//------------------------------------------------------------------------------
+/// \file KernelDAG.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class KernelDAG
+//------------------------------------------------------------------------------
+
+#ifndef KERNEL_DAG_HPP
+#define KERNEL_DAG_HPP
+
+#include <array>
+#include <map>
+#include <vector>
+
+#include "KernelBase.hpp"
+#include "LinearPowerSpectrumBase.hpp"
+#include "MomentumView.hpp"
+#include "Propagator.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class KernelDAG
+ *
+ * \brief shared table of the vertex kernel calls of a set of diagrams
+ *
+ * KernelDAG()
+ *
+ * Diagrams register every vertex they evaluate (over all permutations
+ * of the external momenta and all routings of the loop momentum) as a
+ * kernel type and a list of momenta, each momentum being an integer
+ * combination of the momentum slots of a flat momentum array
+ * (see MomentumView).  Identical momentum combinations and identical
+ * (kernel type, momentum multiset) vertices are merged, giving a DAG:
+ * diagram terms -> kernel nodes -> momentum nodes.
+ *
+ * At a phase space point, an Evaluation computes each momentum node once
+ * and each kernel node at most once (lazily), so a kernel call shared
+ * between diagrams and permutations is only evaluated a single time.
+ * The linear power spectrum on the momentum nodes (for the lines of the
+ * diagrams) is cached in the same way.
+ *
+ * group() further collects kernel nodes whose momenta are a sub-multiset of
+ * the momenta of a larger node.  For a kernel whose sym_subsets shares the
+ * work between subsets (KernelBase::shares_subsets), evaluating the larger
+ * (root) node runs a single recursion for the whole group, and the other
+ * nodes of the group are read off it when they are requested; other kernels
+ * evaluate each node on its own.
+ */
+//------------------------------------------------------------------------------
+
+class KernelDAG
+{
+   public:
+      typedef std::array<int, MomentumView::kNumSlots> Combination;   ///< coefficients of the momentum in each slot
+
+      class Evaluation;
+
+   private:
+      std::vector<Combination> _momenta;                                       ///< unique momentum combinations
+      std::map<Combination, int> _momentumindex;                               ///< lookup of momentum nodes
+      std::vector<KernelType> _kerneltypes;                                    ///< kernel type of each kernel node
+      std::vector<std::vector<int> > _kernelmomenta;                           ///< (sorted) momentum nodes of each kernel node
+      std::map<std::pair<KernelType, std::vector<int> >, int> _kernelindex;    ///< lookup of kernel nodes
+      std::vector<std::vector<int> > _groups;                                  ///< for each kernel node: the nodes evaluated along with it (itself first), empty if none
+      std::vector<std::vector<std::vector<int> > > _groupsubsets;              ///< for each group: the positions of the momenta of each node in the root momenta
+      std::vector<int> _grouproot;                                             ///< for each kernel node: the root of its group, -1 if none
+      std::vector<int> _groupposition;                                         ///< for each kernel node: its position in the group of its root
+      std::vector<int> _groupoffset;                                           ///< for each root: the offset of its group in the group results of an Evaluation
+      int _ngroupvalues;                                                       ///< total size of the groups
+      int _ncalls;                                                             ///< number of vertex calls registered
+
+   public:
+      /// constructor
+      KernelDAG() : _ngroupvalues(0), _ncalls(0) {}
+      /// destructor
+      virtual ~KernelDAG() {}
+
+      /// add a momentum combination, returns its node
+      int add_momentum(const Combination& p);
+
+      /// add a vertex kernel call, returns its node
+      int add_kernel(KernelType ktype, const std::vector<Combination>& p);
+
+      /// group kernel nodes by sub-multisets of the momenta of larger nodes (call after all nodes are added)
+      void group();
+
+      /// number of unique momentum combinations
+      size_t nmomenta() const { return _momenta.size(); }
+
+      /// number of unique kernel calls
+      size_t nkernels() const { return _kerneltypes.size(); }
+
+      /// number of vertex calls mapped onto the kernel nodes
+      int ncalls() const { return _ncalls; }
+
+      /*
+       * momentum combination of a propagator, where the momenta are permuted
+       * with the index array indices (slot i -> slot indices[i], as in MomentumView)
+       * and the loop momentum q is routed as q -> qsign * q + pole
+       */
+      static Combination combination(const Propagator& prop, const int* indices, int qsign = 1, const Combination& pole = Combination());
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \class KernelDAG::Evaluation
+ *
+ * \brief values of the nodes of a KernelDAG at one phase space point
+ *
+ * Evaluation(const KernelDAG& dag, const ThreeVector* flatmom)
+ *
+ * flatmom is a flat momentum array with MomentumView::kNumSlots entries.
+ * The value of a kernel node is stored along with the kernel that computed
+ * it; a request for the same node with a different kernel is computed
+ * directly and not stored.  Likewise for the linear power spectrum.
+ */
+//------------------------------------------------------------------------------
+
+class KernelDAG::Evaluation
+{
+   private:
+      const KernelDAG* _dag;                 ///< the DAG being evaluated
+      std::vector<ThreeVector> _momenta;     ///< values of the momentum nodes
+      std::vector<double> _values;           ///< values of the kernel nodes
+      std::vector<KernelBase*> _kernels;     ///< kernel used for each stored value (nullptr if not evaluated)
+      std::vector<double> _powers;           ///< linear power spectrum at the momentum nodes
+      std::vector<LinearPowerSpectrumBase*> _spectra;   ///< power spectrum used for each stored value (nullptr if not evaluated)
+      std::vector<ThreeVector> _p;           ///< scratch space for the kernel arguments
+      std::vector<double> _Fn;               ///< scratch space for group results
+      std::vector<double> _Gn;               ///< scratch space for group results
+      std::vector<double> _groupFn;          ///< Fn of the nodes of the evaluated groups, at the offset of their root
+      std::vector<double> _groupGn;          ///< Gn of the nodes of the evaluated groups, at the offset of their root
+      std::vector<KernelBase*> _groupkernels;   ///< kernel used for the group of each root (nullptr if not evaluated)
+      int _nkernelcalls;                     ///< number of calls into the kernels so far
+
+   public:
+      /// constructor
+      Evaluation(const KernelDAG& dag, const ThreeVector* flatmom);
+      /// destructor
+      virtual ~Evaluation() {}
+
+      /// value of a momentum node
+      const ThreeVector& momentum(int node) const { return _momenta[node]; }
+
+      /// value of a kernel node, computed with the given kernel
+      double kernel(int node, KernelBase* kernel);
+
+      /// linear power spectrum at the magnitude of a momentum node
+      double linear_power(int node, LinearPowerSpectrumBase* PL);
+
+      /// number of calls into the kernels so far (a group evaluation counts once)
+      int nkernel_calls() const { return _nkernelcalls; }
+
+   private:
+      /// computes a kernel node
+      double compute(int node, KernelBase* kernel);
+
+      /// computes the group results of a root node
+      void compute_group(int root, KernelBase* kernel);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+inline double KernelDAG::Evaluation::kernel(int node, KernelBase* kernel)
+{
+   if (_kernels[node] == kernel) { return _values[node]; }
+   if (_kernels[node] != nullptr) { return compute(node, kernel); }
+   // only the root triggers the group recursion, so a node needed without its
+   // root is evaluated on its own
+   int root = _dag->_grouproot[node];
+   if (root == node && _groupkernels[root] != kernel && kernel->shares_subsets()) { compute_group(root, kernel); }
+   if (root >= 0 && _groupkernels[root] == kernel) {
+      int i = _dag->_groupoffset[root] + _dag->_groupposition[node];
+      _values[node] = (_dag->_kerneltypes[node] == KernelType::delta) ? _groupFn[i] : _groupGn[i];
+   } else {
+      _values[node] = compute(node, kernel);
+   }
+   _kernels[node] = kernel;
+   return _values[node];
+}
+
+//------------------------------------------------------------------------------
+inline double KernelDAG::Evaluation::linear_power(int node, LinearPowerSpectrumBase* PL)
+{
+   if (_spectra[node] == PL) { return _powers[node]; }
+   if (_spectra[node] != nullptr) { return (*PL)(_momenta[node].magnitude()); }
+   _powers[node] = (*PL)(_momenta[node].magnitude());
+   _spectra[node] = PL;
+   return _powers[node];
+}
+
+} // namespace fnfast
+
+#endif // KERNEL_DAG_HPP
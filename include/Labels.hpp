@@ -271,6 +271,63 @@ enum class Graphs_4point : int {
    T3221ax
 };
 
+//------------------------------------------------------------------------------
+// graph names, e.g. "P22", for labeling diagram-level output
+//------------------------------------------------------------------------------
+inline const char* graph_name(Graphs_2point graph)
+{
+   switch (graph) {
+      case Graphs_2point::P11: return "P11";
+      case Graphs_2point::P31: return "P31";
+      case Graphs_2point::P22: return "P22";
+      case Graphs_2point::P51: return "P51";
+      case Graphs_2point::P42: return "P42";
+      case Graphs_2point::P33a: return "P33a";
+      case Graphs_2point::P33b: return "P33b";
+      case Graphs_2point::P31x: return "P31x";
+      case Graphs_2point::P51x: return "P51x";
+      case Graphs_2point::P42x: return "P42x";
+      case Graphs_2point::P33ax: return "P33ax";
+   }
+   return "";
+}
+
+inline const char* graph_name(Graphs_3point graph)
+{
+   switch (graph) {
+      case Graphs_3point::B211: return "B211";
+      case Graphs_3point::B411: return "B411";
+      case Graphs_3point::B321a: return "B321a";
+      case Graphs_3point::B321b: return "B321b";
+      case Graphs_3point::B222: return "B222";
+      case Graphs_3point::B411x: return "B411x";
+      case Graphs_3point::B321ax: return "B321ax";
+   }
+   return "";
+}
+
+inline const char* graph_name(Graphs_4point graph)
+{
+   switch (graph) {
+      case Graphs_4point::T3111: return "T3111";
+      case Graphs_4point::T2211: return "T2211";
+      case Graphs_4point::T5111: return "T5111";
+      case Graphs_4point::T4211a: return "T4211a";
+      case Graphs_4point::T4211b: return "T4211b";
+      case Graphs_4point::T3311a: return "T3311a";
+      case Graphs_4point::T3311b: return "T3311b";
+      case Graphs_4point::T3221a: return "T3221a";
+      case Graphs_4point::T3221b: return "T3221b";
+      case Graphs_4point::T3221c: return "T3221c";
+      case Graphs_4point::T2222: return "T2222";
+      case Graphs_4point::T5111x: return "T5111x";
+      case Graphs_4point::T4211ax: return "T4211ax";
+      case Graphs_4point::T3311ax: return "T3311ax";
+      case Graphs_4point::T3221ax: return "T3221ax";
+   }
+   return "";
+}
+
 } // namespace fnfast
 
 namespace std {
@@ -35,6 +35,9 @@ namespace fnfast {
 class LinearPowerSpectrumBase
 {
    public:
+      /// destructor
+      virtual ~LinearPowerSpectrumBase() {}
+
       /// returns the linear power spectrum
       virtual double operator()(double x) = 0;
 };
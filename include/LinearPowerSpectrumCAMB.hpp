@@ -48,7 +48,6 @@ class LinearPowerSpectrumCAMB : public LinearPowerSpectrumBase
       std::string _input_file;                       ///< input file
       std::vector<double> _kvec, _kvec_patches;      ///< data storage vectors
       std::vector<double> _Pvec, _Pvec_patches;      ///< data storage vectors
-      gsl_interp_accel* _accel_ptr;                  ///< interpolation objects in gsl
       gsl_spline* _spline_ptr;                       ///< interpolation objects in gsl
       double _c0_low, _c1_low, _c0_high, _c1_high;   ///< fit parameters to define high and low k patches
       double _kmin;                                  ///< IR cutoff
@@ -61,14 +60,13 @@ class LinearPowerSpectrumCAMB : public LinearPowerSpectrumBase
       virtual ~LinearPowerSpectrumCAMB()
       {
           gsl_spline_free(_spline_ptr);
-          gsl_interp_accel_free(_accel_ptr);
       }
    
       /// cuts off the power spectrum at kmin
       void set_kmin(double kmin) { _kmin=kmin; }
 
 
-      /// returns the linear power spectrum
+      /// returns the linear power spectrum, only reading the spline (no gsl accelerator), so threads may share the object
       double operator()(double x);
 
    private:
@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+/// \file MomentumView.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class MomentumView
+//------------------------------------------------------------------------------
+
+#ifndef MOMENTUM_VIEW_HPP
+#define MOMENTUM_VIEW_HPP
+
+#include "Labels.hpp"
+#include "LabelMap.hpp"
+#include "ThreeVector.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class MomentumView
+ *
+ * \brief permuted view of a flat array of momenta
+ *
+ * MomentumView(const ThreeVector* mom, const int* indices)
+ *
+ * The momenta of a phase space point are stored in a flat array,
+ * with one slot per Momentum label (see slot()).
+ * The view accesses slot i of the array through the index array,
+ * mom[indices[i]], so that a permutation of the external momenta is
+ * applied without copying any momenta.
+ * The loop momentum q is held by value in the view, so that it can be
+ * reflected or shifted (e.g. into an IR region) without touching the array.
+ */
+//------------------------------------------------------------------------------
+
+class MomentumView
+{
+   public:
+      static const int kNumSlots = 6;     ///< number of Momentum labels
+
+   private:
+      const ThreeVector* _mom;            ///< flat array of momenta
+      const int* _indices;                ///< index indirection into the array
+      ThreeVector _q;                     ///< value of the loop momentum
+
+   public:
+      /// constructor
+      MomentumView(const ThreeVector* mom, const int* indices);
+
+      /// slot of a momentum label in the flat array
+      static int slot(Momentum label) { return static_cast<int>(label) - static_cast<int>(Momentum::q2); }
+
+      /// identity index array
+      static const int* identity();
+
+      /// copies the momenta of a label map into a flat array (kNumSlots entries)
+      static void flatten(const LabelMap<Momentum, ThreeVector>& mom, ThreeVector* flatmom);
+
+      /// the momentum in a given slot
+      const ThreeVector& operator[](int slot) const;
+
+      /// the momentum with a given label
+      const ThreeVector& operator[](Momentum label) const { return operator[](slot(label)); }
+
+      /// the loop momentum
+      const ThreeVector& q() const { return _q; }
+
+      /// reset the loop momentum
+      void set_q(const ThreeVector& q) { _q = q; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+inline MomentumView::MomentumView(const ThreeVector* mom, const int* indices)
+: _mom(mom), _indices(indices), _q(mom[indices[slot(Momentum::q)]])
+{}
+
+//------------------------------------------------------------------------------
+inline const int* MomentumView::identity()
+{
+   static const int indices[kNumSlots] = {0, 1, 2, 3, 4, 5};
+   return indices;
+}
+
+//------------------------------------------------------------------------------
+inline void MomentumView::flatten(const LabelMap<Momentum, ThreeVector>& mom, ThreeVector* flatmom)
+{
+   for (int i = 0; i < kNumSlots; i++) { flatmom[i].setToZero(); }
+   for (auto label : mom.labels()) {
+      flatmom[slot(label)] = mom[label];
+   }
+}
+
+//------------------------------------------------------------------------------
+inline const ThreeVector& MomentumView::operator[](int i) const
+{
+   if (i == slot(Momentum::q)) { return _q; }
+   return _mom[_indices[i]];
+}
+
+} // namespace fnfast
+
+#endif // MOMENTUM_VIEW_HPP
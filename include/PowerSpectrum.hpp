@@ -21,8 +21,10 @@
 
 #include "DiagramSet2pointSPT.hpp"
 #include "DiagramSet2pointEFT.hpp"
+#include "EFTkernels.hpp"
 #include "KernelBase.hpp"
 #include "Integration.hpp"
+#include "ResultCache.hpp"
 
 namespace fnfast {
 
@@ -55,7 +57,12 @@ class PowerSpectrum
       DiagramSet2pointSPT _diagrams;      ///< 2-point diagrams
       DiagramSet2pointEFT _EFTdiagrams;   ///< 2-point EFT diagrams /*DAN*/
       double _UVcutoff;                   ///< UV cutoff for loop integrations
-      int _seed;                          ///< random number seed for VEGAS
+      int _seed;                          ///< random number seed of the integrations
+      IntegrationMethod _method;          ///< integration method of the loop integrals
+      double _epsrel;                     ///< relative accuracy of the integrals
+      int _maxeval;                       ///< maximum number of integrand evaluations of the integrals
+      std::string _statefile;             ///< checkpoint of the integration state, none if empty
+      ResultCache* _cache;                ///< cache of the loop integrals, nullptr if not cached
 
       /// container for the integration options
       struct LoopPhaseSpace
@@ -67,11 +74,16 @@ class PowerSpectrum
          const LabelMap<Vertex, KernelBase*>* kernels;
          LinearPowerSpectrumBase* PL;
          const PowerSpectrum* powerspectrum;
+         int diagram;
+         std::vector<double> kbins;
          static constexpr double pi = 3.14159265358979;
 
          /// constructor
          LoopPhaseSpace(double k, double qlim, const LabelMap<Vertex, KernelBase*>* kern, LinearPowerSpectrumBase* linPS, const PowerSpectrum* powerspec);
 
+         /// set the external momentum magnitude
+         void set_k(double kmag);
+
          /// sample phase space; return the point along with the jacobian
          std::pair<double, LabelMap<Momentum, ThreeVector>* const> generate_point_oneLoop(std::vector<double> xpts);
          std::pair<double, LabelMap<Momentum, ThreeVector>* const> generate_point_twoLoop(std::vector<double> xpts);
@@ -107,22 +119,55 @@ class PowerSpectrum
       /// set the random number seed
       void set_seed(int seed) { _seed = seed; }
 
+      /// set the integration method of the loop integrals (VEGAS by default)
+      void set_method(IntegrationMethod method) { _method = method; }
+
+      /// set the relative accuracy and maximum number of integrand evaluations of the integrals
+      void set_accuracy(double epsrel, int maxeval) { _epsrel = epsrel; _maxeval = maxeval; }
+
+      /// set the checkpoint file of the integration state (see IntegratorBase::statefile), empty for none;
+      /// an integral interrupted with a checkpoint resumes from it when computed again
+      void set_statefile(const std::string& statefile) { _statefile = statefile; }
+
+      /// attach a cache of the loop integrals (see ResultCache), nullptr to detach
+      void set_cache(ResultCache* cache) { _cache = cache; }
+
+      /// attach a profile of the loop integrand diagrams (see DiagramProfile), nullptr to detach; profiled integrals are not taken from the cache
+      void set_profile(DiagramProfile* profile) { _diagrams.set_profile(profile); }
+
       /// get results differential in k
       /// tree level
       double tree(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
       /// one loop integrated over q
       IntegralResult oneLoop(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+      /// one loop integrated over q to an error target
+      IntegralResult oneLoop(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, const ErrorTarget& target) const;
+      /// one loop at each k in a separate integration, each to the error target max(absolute[i], relative |P_tree(k) + P_1loop(k)|),
+      /// so bins where the loop is small against the tree stop early (no absolute targets if absolute is empty)
+      IntegralResults oneLoop_sweep(const std::vector<double>& k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, double relative, const std::vector<double>& absolute = std::vector<double>()) const;
+      /// one loop integrated over q at a set of k, one component per k in a single integration (not profiled)
+      IntegralResults oneLoop(const std::vector<double>& k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+      /// one loop integrated over q, for each diagram and in total
+      DiagramIntegrals oneLoop_diagrams(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, GridMode mode = GridMode::kShared) const;
       /// two loop integrated over q, q2
       IntegralResult twoLoop(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
    
       /// EFT tree level, same order as SPT one loop
       /*DAN*/
       double treeEFT(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+      /// EFT tree level decomposed in the counterterm coefficients, with EFT kernels at exactly one vertex (see EFTbasis)
+      EFTbasis treeEFT_basis(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
 
 
    private:
+      /// integrator of the loop integrals with the method and settings, in this process only while a profile is attached
+      std::unique_ptr<IntegratorBase> make_integrator(int ndim) const;
       /// one loop integrand
       static int oneLoop_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
+      /// one loop integrand, a component per k bin
+      static int oneLoop_kbins_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
+      /// one loop integrand, a single diagram or the total and each diagram
+      static int oneLoop_diagrams_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
       /// two loop integrand
       static int twoLoop_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata);
 };
@@ -133,9 +178,17 @@ class PowerSpectrum
 
 //------------------------------------------------------------------------------
 inline PowerSpectrum::LoopPhaseSpace::LoopPhaseSpace(double kmag, double qlim, const LabelMap<Vertex, KernelBase*>* kern, LinearPowerSpectrumBase* linPS, const PowerSpectrum* powerspec)
-: ndim(2), k(kmag), momenta(LabelMap<Momentum, ThreeVector> {{Momentum::k1, ThreeVector(0, 0, -k)}, {Momentum::k2, ThreeVector(0, 0, -k)}, {Momentum::q, ThreeVector()}}), qmax(qlim), kernels(kern), PL(linPS), powerspectrum(powerspec)
+: ndim(2), k(kmag), momenta(LabelMap<Momentum, ThreeVector> {{Momentum::k1, ThreeVector(0, 0, -k)}, {Momentum::k2, ThreeVector(0, 0, -k)}, {Momentum::q, ThreeVector()}}), qmax(qlim), kernels(kern), PL(linPS), powerspectrum(powerspec), diagram(-1)
 {}
 
+//------------------------------------------------------------------------------
+inline void PowerSpectrum::LoopPhaseSpace::set_k(double kmag)
+{
+   k = kmag;
+   momenta[Momentum::k1] = ThreeVector(0, 0, -k);
+   momenta[Momentum::k2] = ThreeVector(0, 0, -k);
+}
+
 } // namespace fnfast
 
 #endif // POWER_SPECTRUM_HPP
@@ -23,7 +23,9 @@
 #include <map>
 
 #include "LabelMap.hpp"
+#include "MomentumView.hpp"
 #include "ThreeVector.hpp"
+#include "ThreeVectorBatch.hpp"
 
 namespace fnfast {
 
@@ -59,6 +61,7 @@ class Propagator
 
    private:
       LabelMap<Momentum, LabelFlow> _components;     ///< components of the momenta and their scale factors
+      std::vector<std::pair<int, int> > _slots;      ///< nonzero components as (MomentumView slot, sign) pairs
 
    public:
       /// constructor
@@ -69,8 +72,17 @@ class Propagator
       /// accessors
       LabelMap<Momentum, LabelFlow> components() const { return _components; }
 
+      /// nonzero components as (MomentumView slot, sign) pairs
+      const std::vector<std::pair<int, int> >& slots() const { return _slots; }
+
       /// get the momentum given values for the loop, external momenta
-      ThreeVector p(LabelMap<Momentum, ThreeVector> mom) const;
+      ThreeVector p(const LabelMap<Momentum, ThreeVector>& mom) const;
+
+      /// get the momentum from a view of a flat momentum array
+      ThreeVector p(const MomentumView& mom) const;
+
+      /// get the momenta for a batch of points, from a flat array of momentum batches (one per MomentumView slot)
+      ThreeVectorBatch p(const ThreeVectorBatch* mom) const;
 
       /// get the list of labels with coefficients != kNull in the propagator
       std::vector<Momentum> labels() const;
@@ -107,6 +119,28 @@ class Propagator
 // Inline Declarations
 ////////////////////////////////////////////////////////////////////////////////
 
+//------------------------------------------------------------------------------
+inline ThreeVector Propagator::p(const MomentumView& mom) const
+{
+   ThreeVector pvec;
+   for (auto& slot : _slots) {
+      if (slot.second > 0) { pvec += mom[slot.first]; }
+      else { pvec -= mom[slot.first]; }
+   }
+   return pvec;
+}
+
+//------------------------------------------------------------------------------
+inline ThreeVectorBatch Propagator::p(const ThreeVectorBatch* mom) const
+{
+   ThreeVectorBatch pvec;
+   for (auto& slot : _slots) {
+      if (slot.second > 0) { pvec += mom[slot.first]; }
+      else { pvec -= mom[slot.first]; }
+   }
+   return pvec;
+}
+
 //------------------------------------------------------------------------------
 inline std::ostream& operator<<(std::ostream& out, const Propagator& prop)
 {
@@ -0,0 +1,110 @@
+//------------------------------------------------------------------------------
+/// \file ResultCache.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class ResultCache
+//------------------------------------------------------------------------------
+
+#ifndef RESULT_CACHE_HPP
+#define RESULT_CACHE_HPP
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Integration.hpp"
+#include "KernelBase.hpp"
+#include "LabelMap.hpp"
+#include "Labels.hpp"
+#include "LinearPowerSpectrumBase.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class ResultCache
+ *
+ * \brief on-disk store of computed loop integrals
+ *
+ * ResultCache(string path)
+ *
+ * An opt-in cache of integral results (set_cache of PowerSpectrum, Bispectrum
+ * and Covariance), keyed by a string built by key() from
+ * - the observable and its order
+ * - the external configuration (k values, angles)
+ * - the UV cutoff of the phase space and the qmax of the diagrams
+ * - the kernels: their type and a hash of Fn_sym, Gn_sym for n = 1..3 at
+ *   fixed momenta, so that e.g. EFT coefficients enter
+ * - the linear power spectrum: a hash of its values at 128 log-spaced k in
+ *   [1e-5, 1e3], which covers tabulated and analytic spectra alike
+ * - the integrator settings (IntegratorBase::settings)
+ * The file is a text log of "key<TAB>n result error prob ..." lines read at
+ * construction; each stored result is appended and flushed at once, so an
+ * interrupted sweep resumes from the points it completed, and later lines
+ * for a key supersede earlier ones.  Lines are written with a single append,
+ * so processes may share a file; lookups and stores lock, so threads may
+ * share a cache.
+ */
+//------------------------------------------------------------------------------
+
+class ResultCache
+{
+   private:
+      std::string _path;                                          ///< cache file
+      std::unordered_map<std::string, IntegralResults> _results;  ///< results by key
+      long _hits;                                                 ///< number of lookups found
+      long _misses;                                               ///< number of lookups not found
+      mutable std::mutex _mutex;                                  ///< guards the results and the file
+
+   public:
+      /// constructor, reads the cache file if it exists
+      ResultCache(const std::string& path);
+      /// destructor
+      virtual ~ResultCache() {}
+
+      /// cache file
+      const std::string& path() const { return _path; }
+
+      /// number of cached results
+      size_t size() const { std::lock_guard<std::mutex> lock(_mutex); return _results.size(); }
+
+      /// lookup statistics
+      long hits() const { std::lock_guard<std::mutex> lock(_mutex); return _hits; }
+      long misses() const { std::lock_guard<std::mutex> lock(_mutex); return _misses; }
+
+      /// looks up a key, true and the results if found
+      bool find(const std::string& key, IntegralResults& results);
+
+      /// stores results and appends them to the cache file
+      void store(const std::string& key, const IntegralResults& results);
+      void store(const std::string& key, const IntegralResult& result);
+
+      /// removes all results and truncates the cache file
+      void clear();
+
+      /// key of an observable integral
+      static std::string key(const std::string& observable, Order order, const std::vector<double>& config, double UVcutoff, double qmax,
+                             const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, const IntegratorBase& integrator);
+
+      /// hash of the kernels
+      static std::string fingerprint(const LabelMap<Vertex, KernelBase*>& kernels);
+
+      /// hash of the linear power spectrum
+      static std::string fingerprint(LinearPowerSpectrumBase* PL);
+};
+
+} // namespace fnfast
+
+#endif // RESULT_CACHE_HPP
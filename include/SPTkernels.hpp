@@ -22,6 +22,7 @@
 #include <numeric>
 
 #include "KernelBase.hpp"
+#include "ThreeVectorBatch.hpp"
 
 namespace fnfast {
 
@@ -35,59 +36,112 @@ class ThreeVector;
  *
  * Defines the base functions and recursion relations for the SPT kernels
  * Uses fast evaluation methods
+ *
+ * Subsets of the n input momenta are bitmasks (bit i for momentum i).
+ * For each call, the momentum sums of all subsets are built with a DP over
+ * the bitmasks, and the kernels of all subsets are built in increasing order
+ * of the bitmask (every proper subset of m is < m), summing over the splits
+ * of each subset from a flat table of bitmask pairs.
+ *
+ * The tables are built for the largest number of momenta seen so far and
+ * extended on demand, so there is no fixed limit on n; the memory is
+ * O(2^n) for the largest n requested.  The table of subset pairs, which
+ * has (3^n + 1)/2 - 2^n entries, is only stored up to kTableN momenta;
+ * beyond that the pairs of a subset are enumerated on the fly, in the
+ * same order.  The recursion itself costs O(3^n).
+ *
+ * The per-call results (momentum sums and kernels of the subsets) live in a
+ * per-thread Workspace, and the tables are only written by reserve(), so
+ * once the tables are reserved for the largest n needed, one SPTkernels
+ * object can be evaluated from several threads at once.
  */
 //------------------------------------------------------------------------------
 class SPTkernels : public KernelBase
 {
    private:
+      /// split of a subset of the momenta into two nonempty subsets A, B
       struct SubsetPair {
-         std::vector<int> subsetA;
-         int hashA;
-         std::vector<int> subsetB;
-         int hashB;
+         unsigned int maskA;     ///< bitmask of subset A
+         unsigned int maskB;     ///< bitmask of subset B
+         double combfac;         ///< combinatorial factor 1 / binom(k, nA)
+      };
 
-         SubsetPair(std::vector<int> sA, int hA, std::vector<int> sB, int hB)
-         : subsetA(sA), hashA(hA), subsetB(sB), hashB(hB) {}
+      /// per-call results for each subset (bitmask) of the current momenta
+      struct Workspace {
+         std::vector<ThreeVector> psum;      ///< momentum sum
+         std::vector<double> psq;            ///< square of the momentum sum
+         std::vector<double> Fn_sym;         ///< Fn
+         std::vector<double> Gn_sym;         ///< Gn
       };
 
-      double _cFalpha[8];                                   ///< pre-computed constants for Fn coefficient of alpha term
-      double _cFbeta[8];                                    ///< pre-computed constants for Fn coefficient of beta term
-      double _cGalpha[8];                                   ///< pre-computed constants for Gn coefficient of alpha term
-      double _cGbeta[8];                                    ///< pre-computed constants for Gn coefficient of beta term
-      std::vector<std::vector<int> > _binom;                ///< binomial coefficients
-      std::vector<std::vector<std::vector<std::vector<int> > > > _permset;    ///< set of all perms of j indices from 1..i, for 1 <= j <= i <= 7
-      std::vector<std::vector<std::vector<std::vector<SubsetPair> > > > _subsetpairs;   ///< all subset pairs for any subsets of 1..7
-      std::vector<std::vector<std::vector<double> > > _Fn_sym;    ///< container for the coefficients
-      std::vector<std::vector<std::vector<double> > > _Gn_sym;    ///< container for the coefficients
+      static const int kTableN = 10;                  ///< largest number of momenta with a table of subset pairs
+
+      int _nmax;                                      ///< largest number of momenta the tables are built for
+      double _tabletime;                              ///< time spent building the tables (seconds)
+      std::vector<double> _cFalpha;                   ///< pre-computed constants for Fn coefficient of alpha term
+      std::vector<double> _cFbeta;                    ///< pre-computed constants for Fn coefficient of beta term
+      std::vector<double> _cGalpha;                   ///< pre-computed constants for Gn coefficient of alpha term
+      std::vector<double> _cGbeta;                    ///< pre-computed constants for Gn coefficient of beta term
+      std::vector<std::vector<double> > _combfac;     ///< combinatorial factors 1 / binom(k, nA)
+      std::vector<int> _subsetsize;                   ///< number of momenta in each subset (bitmask)
+      std::vector<SubsetPair> _subsetpairs;           ///< all subset pairs of every subset (bitmask) m < 2^min(_nmax, kTableN), contiguous in m
+      std::vector<int> _pairoffsets;                  ///< the pairs of subset m are [_pairoffsets[m], _pairoffsets[m + 1]) in _subsetpairs
 
    public:
-      /// constructor
-      SPTkernels();
+      /// constructor, builds the tables for up to nmax momenta (more are added when needed)
+      SPTkernels(int nmax = 7);
       /// destructor
       ~SPTkernels() {}
 
-      double cF_alpha(int n);   ///< constant for Fn coefficient of alpha term
-      double cF_beta(int n);    ///< constant for Fn coefficient of beta term
-      double cG_alpha(int n);   ///< constant for Gn coefficient of alpha term
-      double cG_beta(int n);    ///< constant for Gn coefficient of beta term
+      double cF_alpha(int n) const;   ///< constant for Fn coefficient of alpha term
+      double cF_beta(int n) const;    ///< constant for Fn coefficient of beta term
+      double cG_alpha(int n) const;   ///< constant for Gn coefficient of alpha term
+      double cG_beta(int n) const;    ///< constant for Gn coefficient of beta term
+
+      double alpha(const ThreeVector& p1, const ThreeVector& p2) const;       ///< kernel function alpha
+      double beta(const ThreeVector& p1, const ThreeVector& p2) const;        ///< kernel function alpha
+
+      DoubleBatch alpha(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2) const;    ///< kernel function alpha, lane by lane
+      DoubleBatch beta(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2) const;     ///< kernel function beta, lane by lane
 
-      double alpha(const ThreeVector& p1, const ThreeVector& p2);       ///< kernel function alpha
-      double beta(const ThreeVector& p1, const ThreeVector& p2);        ///< kernel function alpha
+      /// alpha(pA, pB), alpha(pB, pA) and beta(pA, pB) at once, from pA.pA, pB.pB, pA.pB and (pA + pB).(pA + pB)
+      static void alpha_beta(double pApA, double pBpB, double pApB, double pABpAB, double& alphaAB, double& alphaBA, double& betaAB);
+
+      /// alpha(pA, pB), alpha(pB, pA) and beta(pA, pB) at once
+      static void alpha_beta(const ThreeVector& pA, const ThreeVector& pB, double& alphaAB, double& alphaBA, double& betaAB);
+
+      /// alpha(pA, pB), alpha(pB, pA) and beta(pA, pB) at once, lane by lane
+      static void alpha_beta(const ThreeVectorBatch& pA, const ThreeVectorBatch& pB, DoubleBatch& alphaAB, DoubleBatch& alphaBA, DoubleBatch& betaAB);
 
       double Fn_sym(const std::vector<ThreeVector>& p);    ///< symmetrized SPT kernel Fn (q1, ..., qn)
       double Gn_sym(const std::vector<ThreeVector>& p);    ///< symmetrized SPT kernel Gn (q1, ..., qn)
 
-   private:
-      double Fn_sym_build(const std::vector<ThreeVector>& p, const std::vector<int> indices, int hashvalue);    ///< symmetrized SPT kernel Fn (q1, ..., qn), uses precomputed results to calculate
-      double Gn_sym_build(const std::vector<ThreeVector>& p, const std::vector<int> indices, int hashvalue);    ///< symmetrized SPT kernel Gn (q1, ..., qn), uses precomputed results to calculate
+      /// symmetrized SPT kernels Fn, Gn on each subset of the momentum pool p, from a single recursion over p
+      void sym_subsets(const std::vector<ThreeVector>& p, const std::vector<std::vector<int> >& subsets, std::vector<double>& Fn, std::vector<double>& Gn);
+
+      /// the recursion over the pool computes every subset along the way
+      bool shares_subsets() const { return true; }
+
+      /// extend the tables to kernels of up to n momenta
+      void reserve(int n);
+
+      /// largest number of momenta the tables are built for
+      int nmax() const { return _nmax; }
+
+      /// total time spent building the tables, in seconds
+      double table_time() const { return _tabletime; }
 
-      std::vector<std::vector<int> > generate_permset(int k, int n);     ///< function to generate all ordered k-element subsets of indices 1..n
-      std::vector<SubsetPair> generate_pairedsubsets(const std::vector<int>& indices, int nmax);   ///< function to generate all paired subsets of a set of indices
-      int hash_perm(const std::vector<int>& indices, int nmax);     ///< hashing function for
+      /// number of subset pairs visited by the recursion for a kernel of n momenta, (3^n + 1)/2 - 2^n
+      static double nsplits(int n);
+
+   private:
+      static Workspace& workspace();                                                         ///< the workspace of the calling thread
+      void build_subsets(const std::vector<ThreeVector>& p, int kmax, Workspace& ws) const;   ///< fills the workspace for all subsets of up to kmax of the momenta p
+      void sym_build(unsigned int mask, Workspace& ws) const;                                ///< symmetrized SPT kernels Fn, Gn of a subset (bitmask), uses precomputed results of its subsets to calculate
+      void add_split(const SubsetPair& pair, int k, const Workspace& ws, double& Fn, double& Gn) const;    ///< adds the terms of a subset pair of a k momentum subset to Fn, Gn
 
       /// factorial
-      static int fact(int n) { return (n == 0 || n == 1) ? 1 : n * fact(n-1); }
-      static int int_pow(int base, int exp);
+      static double fact(int n) { return (n == 0 || n == 1) ? 1 : n * fact(n-1); }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -95,25 +149,60 @@ class SPTkernels : public KernelBase
 ////////////////////////////////////////////////////////////////////////////////
 
 //------------------------------------------------------------------------------
-inline int SPTkernels::int_pow(int base, int exp)
+inline void SPTkernels::alpha_beta(double pApA, double pBpB, double pApB, double pABpAB, double& alphaAB, double& alphaBA, double& betaAB)
 {
-   if (exp == 0) { return 1; }
-   if (exp == 1) { return base; }
-   if (base == 1) { return 1; }
-   if (exp < 0) { return 0; }
-
-   int result = 1;
-   while (exp)
-   {
-      if (exp & 1)
-           result *= base;
-      exp >>= 1;
-      base *= base;
-   }
+   // the IR cutoffs of alpha and beta are applied by selecting the result
+   // (with a safe denominator), so there are no branches and the
+   // primitive vectorizes across subset pairs or batch lanes
+   const double eps = 1e-12;
+   bool IRA = (pApA < eps);
+   bool IRB = (pBpB < eps);
+   double denomA = IRA ? 1 : pApA;
+   double denomB = IRB ? 1 : pBpB;
+   alphaAB = IRA ? 0 : 1 + pApB / denomA;
+   alphaBA = IRB ? 0 : 1 + pApB / denomB;
+   betaAB = (IRA || IRB) ? 0 : pABpAB * pApB / (2 * denomA * denomB);
+}
+
+//------------------------------------------------------------------------------
+inline void SPTkernels::alpha_beta(const ThreeVector& pA, const ThreeVector& pB, double& alphaAB, double& alphaBA, double& betaAB)
+{
+   ThreeVector pAB = pA + pB;
+   alpha_beta(pA*pA, pB*pB, pA*pB, pAB*pAB, alphaAB, alphaBA, betaAB);
+}
 
-   return result;
+//------------------------------------------------------------------------------
+inline void SPTkernels::alpha_beta(const ThreeVectorBatch& pA, const ThreeVectorBatch& pB, DoubleBatch& alphaAB, DoubleBatch& alphaBA, DoubleBatch& betaAB)
+{
+   ThreeVectorBatch pAB = pA + pB;
+   DoubleBatch pApA = pA*pA;
+   DoubleBatch pBpB = pB*pB;
+   DoubleBatch pApB = pA*pB;
+   DoubleBatch pABpAB = pAB*pAB;
+   for (int i = 0; i < kBatchWidth; i++) {
+      alpha_beta(pApA[i], pBpB[i], pApB[i], pABpAB[i], alphaAB[i], alphaBA[i], betaAB[i]);
+   }
 }
 
+//------------------------------------------------------------------------------
+inline void SPTkernels::add_split(const SubsetPair& pair, int k, const Workspace& ws, double& Fn, double& Gn) const
+{
+   const ThreeVector& pA = ws.psum[pair.maskA];
+   const ThreeVector& pB = ws.psum[pair.maskB];
+   ThreeVector pAB = pA + pB;
+   // atomic quantities
+   double FnA = ws.Fn_sym[pair.maskA];
+   double FnB = ws.Fn_sym[pair.maskB];
+   double GnA = ws.Gn_sym[pair.maskA];
+   double GnB = ws.Gn_sym[pair.maskB];
+   double alphaAB, alphaBA, betaval;
+   alpha_beta(ws.psq[pair.maskA], ws.psq[pair.maskB], pA*pB, pAB*pAB, alphaAB, alphaBA, betaval); // note beta symmetric
+   // add subset result
+   Fn += pair.combfac * GnA * (_cFalpha[k] * alphaAB * FnB + _cFbeta[k] * betaval * GnB);
+   Fn += pair.combfac * GnB * (_cFalpha[k] * alphaBA * FnA + _cFbeta[k] * betaval * GnA);
+   Gn += pair.combfac * GnA * (_cGalpha[k] * alphaAB * FnB + _cGbeta[k] * betaval * GnB);
+   Gn += pair.combfac * GnB * (_cGalpha[k] * alphaBA * FnA + _cGbeta[k] * betaval * GnA);
+}
 
 } // namespace fnfast
 
@@ -0,0 +1,88 @@
+//------------------------------------------------------------------------------
+/// \file SuperSampleCovariance.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class SuperSampleCovariance
+//------------------------------------------------------------------------------
+
+#ifndef SUPER_SAMPLE_COVARIANCE_HPP
+#define SUPER_SAMPLE_COVARIANCE_HPP
+
+#include <vector>
+
+#include "LinearPowerSpectrumBase.hpp"
+#include "WindowedPowerSpectrum.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class SuperSampleCovariance
+ *
+ * \brief super-sample covariance of the power spectrum
+ *
+ * SuperSampleCovariance(const WindowedPowerSpectrum& window)
+ *
+ * The super-sample part of the power spectrum covariance,
+ *    Cov_SSC(k, k') = sigma_b^2 R(k) R(k') P(k) P(k')
+ * comes from the squeezed limit (q -> 0) of the 4-point diagrams: modes
+ * larger than the survey modulate P(k) through the mean density delta_b in
+ * the survey.  The variance of delta_b is
+ *    sigma_b^2 = 1/V^2 int d^3q/(2pi)^3 |W(q)|^2 P_L(q)
+ * and the response of the tree level trispectrum (DiagramSet4pointSPT) in the
+ * squeezed limit is
+ *    R(k) = dlnP(k)/d delta_b = 47/21 - 1/3 dlnP/dlnk
+ * with P the linear power spectrum.
+ *
+ * The survey geometry enters only through sigma_b^2, which is computed from
+ * the shell integrals of |W|^2 of a WindowedPowerSpectrum, so one window table
+ * serves both the convolved spectra and the SSC.  A full nk x nk matrix costs
+ * nk responses and one sigma_b^2, negligible next to the connected term.
+ * Cov_SSC is in units of the covariance of the measured spectrum, i.e. it adds
+ * to the connected term T(k, k') / V, where T is the angle averaged trispectrum
+ * (Covariance::tree and oneLoop integrate over the angle, giving 2 T).
+ */
+//------------------------------------------------------------------------------
+
+class SuperSampleCovariance
+{
+   private:
+      WindowedPowerSpectrum _window;   ///< shell integrals of the survey window
+
+   public:
+      /// constructor
+      SuperSampleCovariance(const WindowedPowerSpectrum& window) : _window(window) {}
+      /// destructor
+      virtual ~SuperSampleCovariance() {}
+
+      /// variance of the mean density in the survey
+      double sigma_b2(LinearPowerSpectrumBase* PL) const;
+
+      /// response dlnP/d delta_b of the power spectrum to the mean density in the survey
+      double response(double k, LinearPowerSpectrumBase* PL) const;
+
+      /// super-sample covariance of P(k), P(k')
+      double covariance(double k, double kprime, LinearPowerSpectrumBase* PL) const;
+
+      /// super-sample covariance matrix for the k values
+      std::vector<std::vector<double> > covariance(const std::vector<double>& k, LinearPowerSpectrumBase* PL) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace fnfast
+
+#endif // SUPER_SAMPLE_COVARIANCE_HPP
@@ -0,0 +1,349 @@
+//------------------------------------------------------------------------------
+/// \file ThreeVectorBatch.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of classes DoubleBatch and ThreeVectorBatch
+//------------------------------------------------------------------------------
+
+#ifndef THREE_VECTOR_BATCH_HPP
+#define THREE_VECTOR_BATCH_HPP
+
+#include <cmath>
+
+#include "ThreeVector.hpp"
+
+/// number of lanes in a batch, 4 for AVX2 and 8 for AVX-512 hosts
+#ifndef FNFAST_BATCH_WIDTH
+#define FNFAST_BATCH_WIDTH 4
+#endif
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class DoubleBatch
+ *
+ * \brief a batch of doubles, one per lane
+ *
+ * Element-wise arithmetic (+, -, *, /, also with a double) on
+ * kBatchWidth values, e.g. scalar products of ThreeVectorBatches.
+ */
+//------------------------------------------------------------------------------
+
+static const int kBatchWidth = FNFAST_BATCH_WIDTH;   ///< number of lanes in a batch
+
+struct alignas(8 * FNFAST_BATCH_WIDTH) DoubleBatch
+{
+   double v[kBatchWidth];     ///< lane values
+
+   /// Creates a zero batch.
+   DoubleBatch() { for (int i = 0; i < kBatchWidth; i++) { v[i] = 0; } }
+
+   /// Creates a batch with the same value in every lane.
+   explicit DoubleBatch(double x) { for (int i = 0; i < kBatchWidth; i++) { v[i] = x; } }
+
+   double operator[](int i) const { return v[i]; }
+   double& operator[](int i) { return v[i]; }
+};
+
+//------------------------------------------------------------------------------
+/**
+ * \class ThreeVectorBatch
+ *
+ * \brief kBatchWidth ThreeVectors stored as a structure of arrays
+ *
+ * Companion of ThreeVector for evaluating several phase space points at
+ * once: lane i holds the ThreeVector of point i, and the components are
+ * stored component-major, so the algebra is a plain loop over the lanes
+ * that the compiler vectorizes (use -march=native, and
+ * -DFNFAST_BATCH_WIDTH=8 on AVX-512 hosts).  It is used by the batched
+ * kernel functions (SPTkernels, EFTkernels, Propagator) and window functions.
+ *
+ * Each operation takes the same steps as its ThreeVector counterpart (a
+ * quotient is a product with the reciprocal in both), so a lane reproduces
+ * the ThreeVector result bit for bit.  The exception is a build that lets
+ * the compiler contract multiply-adds (e.g. -march=native on FMA hosts),
+ * where the vectorized and scalar code may round differently.
+ *
+ * The algebra mirrors ThreeVector:
+ * - p = q + r, p = q - r, p = -q
+ * - p = c * q, p = q * c, p = q / c (c a double or a DoubleBatch)
+ * - c = q * p            (scalar product, a DoubleBatch)
+ * - p += q, p -= q, p *= c
+ * - crossProduct(q, r), square(), magnitude()
+ */
+//------------------------------------------------------------------------------
+
+class alignas(8 * FNFAST_BATCH_WIDTH) ThreeVectorBatch
+{
+   protected:
+      double _p1[kBatchWidth];         ///< 1-components
+      double _p2[kBatchWidth];         ///< 2-components
+      double _p3[kBatchWidth];         ///< 3-components
+
+   public:
+      /// Creates a batch of zero vectors.
+      ThreeVectorBatch();
+
+      /// Creates a batch with the same ThreeVector in every lane.
+      explicit ThreeVectorBatch(const ThreeVector& p);
+
+      /// Returns the ThreeVector in a lane.
+      ThreeVector get(int lane) const { return ThreeVector(_p1[lane], _p2[lane], _p3[lane]); }
+
+      /// Sets the ThreeVector in a lane.
+      void set(int lane, const ThreeVector& p);
+
+      /// Access to the components of a lane
+      double& p1(int lane) { return _p1[lane]; }
+      double& p2(int lane) { return _p2[lane]; }
+      double& p3(int lane) { return _p3[lane]; }
+      double p1(int lane) const { return _p1[lane]; }
+      double p2(int lane) const { return _p2[lane]; }
+      double p3(int lane) const { return _p3[lane]; }
+
+      /// Sets all lanes to zero.
+      void setToZero();
+
+      ThreeVectorBatch& operator+=(const ThreeVectorBatch& rhs);
+      ThreeVectorBatch& operator-=(const ThreeVectorBatch& rhs);
+      ThreeVectorBatch& operator*=(double rhs);
+      ThreeVectorBatch& operator*=(const DoubleBatch& rhs);
+
+      /// Returns the squares of the ThreeVectors.
+      DoubleBatch square() const;
+
+      /// Returns the magnitudes of the ThreeVectors.
+      DoubleBatch magnitude() const;
+
+      friend DoubleBatch operator*(const ThreeVectorBatch& lhs, const ThreeVectorBatch& rhs);
+      friend const ThreeVectorBatch operator*(const DoubleBatch& lhs, const ThreeVectorBatch& rhs);
+      friend const ThreeVectorBatch crossProduct(const ThreeVectorBatch& lhs, const ThreeVectorBatch& rhs);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+// DoubleBatch arithmetic
+//------------------------------------------------------------------------------
+inline const DoubleBatch operator+(const DoubleBatch& lhs, const DoubleBatch& rhs)
+{
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) { result.v[i] = lhs.v[i] + rhs.v[i]; }
+   return result;
+}
+
+inline const DoubleBatch operator-(const DoubleBatch& lhs, const DoubleBatch& rhs)
+{
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) { result.v[i] = lhs.v[i] - rhs.v[i]; }
+   return result;
+}
+
+inline const DoubleBatch operator*(const DoubleBatch& lhs, const DoubleBatch& rhs)
+{
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) { result.v[i] = lhs.v[i] * rhs.v[i]; }
+   return result;
+}
+
+inline const DoubleBatch operator/(const DoubleBatch& lhs, const DoubleBatch& rhs)
+{
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) { result.v[i] = lhs.v[i] / rhs.v[i]; }
+   return result;
+}
+
+inline const DoubleBatch operator+(const DoubleBatch& lhs, double rhs)
+{
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) { result.v[i] = lhs.v[i] + rhs; }
+   return result;
+}
+
+inline const DoubleBatch operator*(double lhs, const DoubleBatch& rhs)
+{
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) { result.v[i] = lhs * rhs.v[i]; }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// ThreeVectorBatch members
+//------------------------------------------------------------------------------
+inline ThreeVectorBatch::ThreeVectorBatch()
+{
+   setToZero();
+}
+
+//------------------------------------------------------------------------------
+inline ThreeVectorBatch::ThreeVectorBatch(const ThreeVector& p)
+{
+   for (int i = 0; i < kBatchWidth; i++) { set(i, p); }
+}
+
+//------------------------------------------------------------------------------
+inline void ThreeVectorBatch::set(int lane, const ThreeVector& p)
+{
+   _p1[lane] = p.p1();
+   _p2[lane] = p.p2();
+   _p3[lane] = p.p3();
+}
+
+//------------------------------------------------------------------------------
+inline void ThreeVectorBatch::setToZero()
+{
+   for (int i = 0; i < kBatchWidth; i++) {
+      _p1[i] = 0;
+      _p2[i] = 0;
+      _p3[i] = 0;
+   }
+}
+
+//------------------------------------------------------------------------------
+inline ThreeVectorBatch& ThreeVectorBatch::operator+=(const ThreeVectorBatch& rhs)
+{
+   for (int i = 0; i < kBatchWidth; i++) {
+      _p1[i] += rhs._p1[i];
+      _p2[i] += rhs._p2[i];
+      _p3[i] += rhs._p3[i];
+   }
+   return *this;
+}
+
+//------------------------------------------------------------------------------
+inline ThreeVectorBatch& ThreeVectorBatch::operator-=(const ThreeVectorBatch& rhs)
+{
+   for (int i = 0; i < kBatchWidth; i++) {
+      _p1[i] -= rhs._p1[i];
+      _p2[i] -= rhs._p2[i];
+      _p3[i] -= rhs._p3[i];
+   }
+   return *this;
+}
+
+//------------------------------------------------------------------------------
+inline ThreeVectorBatch& ThreeVectorBatch::operator*=(double rhs)
+{
+   for (int i = 0; i < kBatchWidth; i++) {
+      _p1[i] *= rhs;
+      _p2[i] *= rhs;
+      _p3[i] *= rhs;
+   }
+   return *this;
+}
+
+//------------------------------------------------------------------------------
+inline ThreeVectorBatch& ThreeVectorBatch::operator*=(const DoubleBatch& rhs)
+{
+   for (int i = 0; i < kBatchWidth; i++) {
+      _p1[i] *= rhs.v[i];
+      _p2[i] *= rhs.v[i];
+      _p3[i] *= rhs.v[i];
+   }
+   return *this;
+}
+
+//------------------------------------------------------------------------------
+inline DoubleBatch ThreeVectorBatch::square() const
+{
+   return (*this) * (*this);
+}
+
+//------------------------------------------------------------------------------
+inline DoubleBatch ThreeVectorBatch::magnitude() const
+{
+   DoubleBatch result = square();
+   for (int i = 0; i < kBatchWidth; i++) { result.v[i] = std::sqrt(result.v[i]); }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+// ThreeVectorBatch algebra
+//------------------------------------------------------------------------------
+inline const ThreeVectorBatch operator+(const ThreeVectorBatch& lhs, const ThreeVectorBatch& rhs)
+{
+   ThreeVectorBatch result = lhs;
+   return result += rhs;
+}
+
+inline const ThreeVectorBatch operator-(const ThreeVectorBatch& lhs, const ThreeVectorBatch& rhs)
+{
+   ThreeVectorBatch result = lhs;
+   return result -= rhs;
+}
+
+inline const ThreeVectorBatch operator-(const ThreeVectorBatch& lhs)
+{
+   ThreeVectorBatch result = lhs;
+   return result *= -1.;
+}
+
+inline const ThreeVectorBatch operator*(double lhs, const ThreeVectorBatch& rhs)
+{
+   ThreeVectorBatch result = rhs;
+   return result *= lhs;
+}
+
+inline const ThreeVectorBatch operator*(const ThreeVectorBatch& lhs, double rhs)
+{
+   ThreeVectorBatch result = lhs;
+   return result *= rhs;
+}
+
+inline const ThreeVectorBatch operator*(const DoubleBatch& lhs, const ThreeVectorBatch& rhs)
+{
+   ThreeVectorBatch result = rhs;
+   return result *= lhs;
+}
+
+inline const ThreeVectorBatch operator/(const ThreeVectorBatch& lhs, double rhs)
+{
+   ThreeVectorBatch result = lhs;
+   return result *= 1. / rhs;
+}
+
+inline const ThreeVectorBatch operator/(const ThreeVectorBatch& lhs, const DoubleBatch& rhs)
+{
+   ThreeVectorBatch result = lhs;
+   return result *= DoubleBatch(1.) / rhs;
+}
+
+// scalar product, lane by lane
+inline DoubleBatch operator*(const ThreeVectorBatch& lhs, const ThreeVectorBatch& rhs)
+{
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) {
+      result.v[i] = lhs._p1[i] * rhs._p1[i] + lhs._p2[i] * rhs._p2[i] + lhs._p3[i] * rhs._p3[i];
+   }
+   return result;
+}
+
+// cross product, lane by lane
+inline const ThreeVectorBatch crossProduct(const ThreeVectorBatch& lhs, const ThreeVectorBatch& rhs)
+{
+   ThreeVectorBatch result;
+   for (int i = 0; i < kBatchWidth; i++) {
+      result._p1[i] = lhs._p2[i] * rhs._p3[i] - lhs._p3[i] * rhs._p2[i];
+      result._p2[i] = lhs._p3[i] * rhs._p1[i] - lhs._p1[i] * rhs._p3[i];
+      result._p3[i] = lhs._p1[i] * rhs._p2[i] - lhs._p2[i] * rhs._p1[i];
+   }
+   return result;
+}
+
+} // namespace fnfast
+
+#endif // THREE_VECTOR_BATCH_HPP
@@ -20,6 +20,7 @@
 #define WINDOW_FUNCTION_BASE_HPP
 
 #include "ThreeVector.hpp"
+#include "ThreeVectorBatch.hpp"
 
 namespace fnfast {
 
@@ -31,20 +32,55 @@ namespace fnfast {
  *
  * Provides virtual functions:
  * - to evaluate the window function
+ * - to evaluate the window function at a batch of kBatchWidth points; the
+ *   default loops over the lanes, implementations override it with
+ *   vectorized evaluation (see WindowFunctionSeparable, WindowFunctionRadial)
+ * - to evaluate the window function at an array of points, in batches
  */
 //------------------------------------------------------------------------------
 
 class WindowFunctionBase
 {
    public:
-      /// returns the linear power spectrum
-      virtual double operator()(ThreeVector x) = 0;
+      /// destructor
+      virtual ~WindowFunctionBase() {}
+
+      /// returns the window function value
+      virtual double operator()(const ThreeVector& x) const = 0;
+
+      /// returns the window function values at a batch of points
+      virtual DoubleBatch operator()(const ThreeVectorBatch& x) const;
+
+      /// window function values w[i] = W(x[i]) at n points
+      void evaluate(const ThreeVector* x, double* w, int n) const;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
 // Inline Declarations
 ////////////////////////////////////////////////////////////////////////////////
 
-} // namespace std
+//------------------------------------------------------------------------------
+inline DoubleBatch WindowFunctionBase::operator()(const ThreeVectorBatch& x) const
+{
+   DoubleBatch w;
+   for (int i = 0; i < kBatchWidth; i++) { w[i] = (*this)(x.get(i)); }
+   return w;
+}
+
+//------------------------------------------------------------------------------
+inline void WindowFunctionBase::evaluate(const ThreeVector* x, double* w, int n) const
+{
+   int i = 0;
+   for (; i + kBatchWidth <= n; i += kBatchWidth) {
+      ThreeVectorBatch xbatch;
+      for (int lane = 0; lane < kBatchWidth; lane++) { xbatch.set(lane, x[i + lane]); }
+      DoubleBatch wbatch = (*this)(xbatch);
+      for (int lane = 0; lane < kBatchWidth; lane++) { w[i + lane] = wbatch[lane]; }
+   }
+   // remainder
+   for (; i < n; i++) { w[i] = (*this)(x[i]); }
+}
+
+} // namespace fnfast
 
 #endif // WINDOW_FUNCTION_BASE_HPP
@@ -0,0 +1,96 @@
+//------------------------------------------------------------------------------
+/// \file WindowFunctionRadial.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class WindowFunctionRadial
+//------------------------------------------------------------------------------
+
+#ifndef WINDOW_FUNCTION_RADIAL_HPP
+#define WINDOW_FUNCTION_RADIAL_HPP
+
+#include <vector>
+
+#include "ThreeVector.hpp"
+#include "ThreeVectorBatch.hpp"
+#include "WindowFunctionBase.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class WindowFunctionRadial
+ *
+ * \brief spherically symmetric window function from a radial table
+ *
+ * WindowFunctionRadial(const WindowFunctionBase& W, double xmax, int n)
+ * WindowFunctionRadial(const std::vector<double>& values, double xmax)
+ *
+ * For spherical windows W(x) = W(|x|), tabulated at n equally spaced radii
+ * in [0, xmax] and interpolated linearly, so an evaluation is one square root
+ * and one lookup.  The table is taken either from a window function along the
+ * 3-axis or from given values.  The window is zero beyond xmax.
+ */
+//------------------------------------------------------------------------------
+
+class WindowFunctionRadial: public WindowFunctionBase
+{
+   private:
+      double _h;                       ///< table spacing
+      std::vector<double> _table;      ///< window function at the radii j h
+
+   public:
+      /// constructor, tabulates W along the 3-axis
+      WindowFunctionRadial(const WindowFunctionBase& W, double xmax, int n);
+      /// constructor from the values at n equally spaced radii in [0, xmax]
+      WindowFunctionRadial(const std::vector<double>& values, double xmax);
+      /// destructor
+      virtual ~WindowFunctionRadial() {}
+
+      /// returns the window function value
+      double operator()(const ThreeVector& x) const { return radial(x.magnitude()); }
+
+      /// returns the window function values at a batch of points
+      DoubleBatch operator()(const ThreeVectorBatch& x) const;
+
+      /// window function at radius r
+      double radial(double r) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+inline double WindowFunctionRadial::radial(double r) const
+{
+   double u = r / _h;
+   bool inside = (u < _table.size() - 1);
+   // branch free, so that the batched version vectorizes
+   int j = inside ? static_cast<int>(u) : 0;
+   double value = _table[j] + (_table[j+1] - _table[j]) * (u - j);
+   return inside ? value : 0;
+}
+
+//------------------------------------------------------------------------------
+inline DoubleBatch WindowFunctionRadial::operator()(const ThreeVectorBatch& x) const
+{
+   DoubleBatch r = x.magnitude();
+   DoubleBatch w;
+   for (int lane = 0; lane < kBatchWidth; lane++) { w[lane] = radial(r[lane]); }
+   return w;
+}
+
+} // namespace fnfast
+
+#endif // WINDOW_FUNCTION_RADIAL_HPP
@@ -0,0 +1,147 @@
+//------------------------------------------------------------------------------
+/// \file WindowFunctionSeparable.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class WindowFunctionSeparable and of the batched sinc
+//------------------------------------------------------------------------------
+
+#ifndef WINDOW_FUNCTION_SEPARABLE_HPP
+#define WINDOW_FUNCTION_SEPARABLE_HPP
+
+#include <cmath>
+
+#include "ThreeVector.hpp"
+#include "ThreeVectorBatch.hpp"
+#include "WindowFunctionBase.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class WindowFunctionSeparable
+ *
+ * \brief Base class for separable window functions
+ *
+ * WindowFunctionSeparable(double V)
+ *
+ * Window functions that factorize over the axes,
+ *    W(x) = V w_1(x_1) w_2(x_2) w_3(x_3)
+ * with w_i(0) = 1 and V the survey volume.  Implementations provide the axis
+ * factors, for a single value and for a batch; the batched window function is
+ * then three batched axis factors and two products, with no virtual call per
+ * point.
+ */
+//------------------------------------------------------------------------------
+
+class WindowFunctionSeparable: public WindowFunctionBase
+{
+   protected:
+      double _V;     ///< survey volume, the window function at x = 0
+
+   public:
+      /// constructor
+      WindowFunctionSeparable(double V) : _V(V) {}
+      /// destructor
+      virtual ~WindowFunctionSeparable() {}
+
+      /// survey volume
+      double volume() const { return _V; }
+
+      /// window factor along axis i (0, 1, 2)
+      virtual double axis(int i, double xi) const = 0;
+
+      /// window factors along axis i for a batch of values
+      virtual DoubleBatch axis(int i, const DoubleBatch& xi) const;
+
+      /// returns the window function value
+      double operator()(const ThreeVector& x) const { return _V * axis(0, x.p1()) * axis(1, x.p2()) * axis(2, x.p3()); }
+
+      /// returns the window function values at a batch of points
+      DoubleBatch operator()(const ThreeVectorBatch& x) const;
+};
+
+/// sin(x) / x, by the batched sinc
+inline double sinc(double x);
+
+/// sin(x) / x in each lane
+inline DoubleBatch sinc(const DoubleBatch& x);
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+inline DoubleBatch WindowFunctionSeparable::axis(int i, const DoubleBatch& xi) const
+{
+   DoubleBatch w;
+   for (int lane = 0; lane < kBatchWidth; lane++) { w[lane] = axis(i, xi[lane]); }
+   return w;
+}
+
+//------------------------------------------------------------------------------
+inline DoubleBatch WindowFunctionSeparable::operator()(const ThreeVectorBatch& x) const
+{
+   DoubleBatch x1, x2, x3;
+   for (int lane = 0; lane < kBatchWidth; lane++) {
+      x1[lane] = x.p1(lane);
+      x2[lane] = x.p2(lane);
+      x3[lane] = x.p3(lane);
+   }
+   return _V * (axis(0, x1) * axis(1, x2) * axis(2, x3));
+}
+
+//------------------------------------------------------------------------------
+inline double sinc(double x)
+{
+   return sinc(DoubleBatch(x))[0];
+}
+
+//------------------------------------------------------------------------------
+inline DoubleBatch sinc(const DoubleBatch& x)
+{
+   // x = n pi + r with |r| <= pi/2, so sin(x) = (-1)^n sin(r); pi is split in
+   // two so that r is accurate for large x.  Each step is a loop over the
+   // lanes, branch free, so that a single batch vectorizes.  Rounding to the
+   // nearest integer adds and subtracts 1.5 2^52 (valid for |x| < 2^50), which
+   // needs no rounding instruction; n - 2 round(n/2) is 0 for even n, +-1 for odd.
+   const double piHi = 3.141592653589793116;
+   const double piLo = 1.2246467991473532e-16;
+   const double round = 6755399441055744.;
+   double n[kBatchWidth], r[kBatchWidth], r2[kBatchWidth], sign[kBatchWidth];
+   for (int i = 0; i < kBatchWidth; i++) { n[i] = (x[i] * (1 / piHi) + round) - round; }
+   for (int i = 0; i < kBatchWidth; i++) { r[i] = (x[i] - n[i] * piHi) - n[i] * piLo; }
+   for (int i = 0; i < kBatchWidth; i++) { r2[i] = r[i] * r[i]; }
+   for (int i = 0; i < kBatchWidth; i++) { sign[i] = 1 - 2 * std::abs(n[i] - 2 * ((n[i] / 2 + round) - round)); }
+
+   // Taylor series of sin(r) to r^17, relative error below 1e-13 for |r| <= pi/2
+   const double c[8] = {-1./6, 1./120, -1./5040, 1./362880, -1./39916800, 1./6227020800,
+                        -1./1307674368000, 1./355687428096000};
+   double poly[kBatchWidth];
+   for (int i = 0; i < kBatchWidth; i++) { poly[i] = c[7]; }
+   for (int j = 6; j >= 0; j--) {
+      for (int i = 0; i < kBatchWidth; i++) { poly[i] = c[j] + r2[i] * poly[i]; }
+   }
+
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) {
+      double x0 = (x[i] == 0) ? 1 : x[i];
+      double value = sign[i] * r[i] * (1 + r2[i] * poly[i]) / x0;
+      result[i] = (x[i] == 0) ? 1 : value;
+   }
+   return result;
+}
+
+} // namespace fnfast
+
+#endif // WINDOW_FUNCTION_SEPARABLE_HPP
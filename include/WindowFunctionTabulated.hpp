@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------
+/// \file WindowFunctionTabulated.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class WindowFunctionTabulated
+//------------------------------------------------------------------------------
+
+#ifndef WINDOW_FUNCTION_TABULATED_HPP
+#define WINDOW_FUNCTION_TABULATED_HPP
+
+#include <vector>
+
+#include "ThreeVectorBatch.hpp"
+#include "WindowFunctionSeparable.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class WindowFunctionTabulated
+ *
+ * \brief separable window function from precomputed per-axis tables
+ *
+ * WindowFunctionTabulated(const WindowFunctionSeparable& W, double xmax, int n)
+ *
+ * Tabulates the axis factors of a separable window at n equally spaced
+ * points in [-xmax, xmax] and interpolates linearly between them, so an
+ * evaluation costs three table lookups and no transcendental functions.  The
+ * window is zero outside the table.  The values at the nodes are exact; in
+ * between the error is h^2/8 |w_i''| for spacing h, e.g. for the top hat of
+ * side L it is (h L)^2 / 96 relative to V.
+ */
+//------------------------------------------------------------------------------
+
+class WindowFunctionTabulated: public WindowFunctionSeparable
+{
+   private:
+      double _xmax;                          ///< tables cover [-xmax, xmax]
+      double _h;                             ///< table spacing
+      std::vector<double> _tables[3];        ///< axis factors at the nodes
+
+   public:
+      /// constructor, tabulates the axis factors of W
+      WindowFunctionTabulated(const WindowFunctionSeparable& W, double xmax, int n);
+      /// destructor
+      virtual ~WindowFunctionTabulated() {}
+
+      /// interpolated window factor along axis i
+      double axis(int i, double xi) const;
+
+      /// interpolated window factors along axis i for a batch of values
+      DoubleBatch axis(int i, const DoubleBatch& xi) const;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+//------------------------------------------------------------------------------
+inline double WindowFunctionTabulated::axis(int i, double xi) const
+{
+   const std::vector<double>& table = _tables[i];
+   double u = (xi + _xmax) / _h;
+   bool inside = (u >= 0 && u < table.size() - 1);
+   // branch free, so that the batched version vectorizes
+   int j = inside ? static_cast<int>(u) : 0;
+   double value = table[j] + (table[j+1] - table[j]) * (u - j);
+   return inside ? value : 0;
+}
+
+//------------------------------------------------------------------------------
+inline DoubleBatch WindowFunctionTabulated::axis(int i, const DoubleBatch& xi) const
+{
+   DoubleBatch w;
+   for (int lane = 0; lane < kBatchWidth; lane++) { w[lane] = WindowFunctionTabulated::axis(i, xi[lane]); }
+   return w;
+}
+
+} // namespace fnfast
+
+#endif // WINDOW_FUNCTION_TABULATED_HPP
@@ -19,8 +19,8 @@
 #ifndef WINDOW_FUNCTION_TOPHAT_HPP
 #define WINDOW_FUNCTION_TOPHAT_HPP
 
-#include "ThreeVector.hpp"
-#include <cmath>
+#include "ThreeVectorBatch.hpp"
+#include "WindowFunctionSeparable.hpp"
 
 namespace fnfast {
 
@@ -33,30 +33,27 @@ namespace fnfast {
  * Provides functions:
  * - to evaluate the window function top hat in Fourier space.
  * In real space W(x) = 1 if x is inside the survey volume and W(x) = 0 otherwise.
+ * The survey is a cube of side L, so the window function is separable with
+ * axis factors sinc(x_i L/2), evaluated by the batched sinc.
  *
  */
 //------------------------------------------------------------------------------
 
-class WindowFunctionTopHat: public WindowFunctionBase
+class WindowFunctionTopHat: public WindowFunctionSeparable
 {
    private:
-      /// survey linear size and volume
-      double _L, _V;
+      /// survey linear size
+      double _L;
 
    public:
       /// constructor
-      WindowFunctionTopHat(double L): _L(L), _V(L * L * L) {}
+      WindowFunctionTopHat(double L): WindowFunctionSeparable(L * L * L), _L(L) {}
 
-      /// returns the window function value
-      double operator()(ThreeVector x) { return _V * _Wi(x.p1()) * _Wi(x.p2()) * _Wi(x.p3()); }
-
-   private:
-      /// helper function
       /// Fourier transform of a single component
-      double _Wi(double xi) {
-         if (xi == 0) return 1;
-         else return sin(xi * _L/2) / (xi * _L/2);
-      }
+      double axis(int, double xi) const { return sinc(xi * _L/2); }
+
+      /// Fourier transform of a single component for a batch
+      DoubleBatch axis(int, const DoubleBatch& xi) const { return sinc((_L/2) * xi); }
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,111 @@
+//------------------------------------------------------------------------------
+/// \file WindowedPowerSpectrum.hpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Interface of class WindowedPowerSpectrum
+//------------------------------------------------------------------------------
+
+#ifndef WINDOWED_POWER_SPECTRUM_HPP
+#define WINDOWED_POWER_SPECTRUM_HPP
+
+#include <vector>
+
+#include "PowerSpectrum.hpp"
+#include "WindowFunctionBase.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+/**
+ * \class WindowedPowerSpectrum
+ *
+ * \brief power spectrum convolved with a survey window
+ *
+ * WindowedPowerSpectrum(const WindowFunctionBase& W, double V, double smax, int ns, int ngrid)
+ *
+ * The convolved (monopole) power spectrum is
+ *    P_W(k) = 1/V int d^3s/(2pi)^3 |W(s)|^2 P(|k - s|)
+ * where W is the Fourier transform of the survey mask and V its volume
+ * (so P_W = P for a constant P).  The angle average over k only involves the
+ * radial distribution of |W|^2, and the angular integral of P reduces to the
+ * cumulative table H(q) = int_0^q dq' q' P(q'):
+ *    P_W(k) = 1/((2pi)^3 V) sum_shells M_s [H(k + s) - H(|k - s|)] / (2 k s)
+ * with M_s the integral of |W|^2 over the shell at radius s.
+ *
+ * The constructor computes the shell integrals once per window, summing |W|^2
+ * over a grid of ngrid^3 cells covering [-smax, smax]^3 and binning by |s| into
+ * ns shells, so the grid should resolve the window (cell size well below
+ * 2pi / survey size) and smax should cover it; the fraction of the
+ * normalization captured is window_norm().  A convolution then costs O(ns)
+ * per output k for a whole vector of k: the power spectrum is only needed on
+ * a grid of nodes (linearly interpolated, going to zero at k = 0 and taken as
+ * zero beyond the last node, so the nodes should extend smax beyond the
+ * largest output k).
+ */
+//------------------------------------------------------------------------------
+
+class WindowedPowerSpectrum
+{
+   private:
+      double _volume;                  ///< survey volume
+      std::vector<double> _s;          ///< mean radius of each shell
+      std::vector<double> _mass;       ///< integral of |W|^2 / ((2pi)^3 V) over each shell
+      static constexpr double pi = 3.14159265358979;
+
+   public:
+      /// constructor, computes the shell integrals of |W|^2
+      WindowedPowerSpectrum(const WindowFunctionBase& W, double volume, double smax, int ns = 200, int ngrid = 256);
+      /// destructor
+      virtual ~WindowedPowerSpectrum() {}
+
+      /// survey volume
+      double volume() const { return _volume; }
+
+      /// mean radius of each shell
+      const std::vector<double>& window_shells() const { return _s; }
+
+      /// integral of |W|^2 / ((2pi)^3 V) over each shell
+      const std::vector<double>& window_masses() const { return _mass; }
+
+      /// integral of |W|^2 / ((2pi)^3 V) over the grid, 1 if the grid covers the whole window
+      double window_norm() const;
+
+      /// convolves a power spectrum given at the (increasing) nodes knodes, at each k
+      std::vector<double> convolve(const std::vector<double>& knodes, const std::vector<double>& Pnodes, const std::vector<double>& k) const;
+
+      /// convolved tree level power spectrum at each k, from the tree level at the nodes knodes
+      std::vector<double> tree(const PowerSpectrum& PS, const std::vector<double>& knodes, const std::vector<double>& k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+      /// convolved one loop power spectrum at each k, from the one loop integrals at the nodes knodes, a single
+      /// integration with a component per node (the errors are convolved as well)
+      IntegralResults oneLoop(const PowerSpectrum& PS, const std::vector<double>& knodes, const std::vector<double>& k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const;
+
+   private:
+      /// cumulative integral H(q) of q P(q) at the nodes, for P linear between the nodes
+      static std::vector<double> cumulative(const std::vector<double>& knodes, const std::vector<double>& Pnodes);
+
+      /// H(q) at any q, from the cumulative integral at the nodes
+      static double cumulative(double q, const std::vector<double>& knodes, const std::vector<double>& Pnodes, const std::vector<double>& Hnodes);
+
+      /// P(q) at any q, interpolated between the nodes
+      static double interpolate(double q, const std::vector<double>& knodes, const std::vector<double>& Pnodes);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// Inline Declarations
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace fnfast
+
+#endif // WINDOWED_POWER_SPECTRUM_HPP
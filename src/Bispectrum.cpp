@@ -25,9 +25,18 @@ namespace fnfast {
 //------------------------------------------------------------------------------
 /*DAN*/
 Bispectrum::Bispectrum(Order order)
-: _order(order), _diagrams(DiagramSet3pointSPT(_order)), _EFTdiagrams(DiagramSet3pointEFT(_EFTorder(_order))), _UVcutoff(10.)
+: _order(order), _diagrams(DiagramSet3pointSPT(_order)), _EFTdiagrams(DiagramSet3pointEFT(_EFTorder(_order))), _UVcutoff(10.), _seed(37), _method(IntegrationMethod::kVEGAS), _epsrel(1e-3), _maxeval(250000), _cache(nullptr), _reflectphi(true)
 {}
 
+//------------------------------------------------------------------------------
+std::unique_ptr<IntegratorBase> Bispectrum::make_integrator(int ndim) const
+{
+   std::unique_ptr<IntegratorBase> integrator = IntegratorBase::create(_method, ndim, _seed, _epsrel, _maxeval, _statefile);
+   // the profile is recorded in the integrand, which must not run in Cuba's worker processes
+   integrator->serial = (_diagrams.profile() != nullptr);
+   return integrator;
+}
+
 //------------------------------------------------------------------------------
 double Bispectrum::tree(double k1, double k2, double theta12, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
 {
@@ -45,11 +54,36 @@ IntegralResult Bispectrum::oneLoop(double k1, double k2, double theta12, const L
 {
    // integration method
    LoopPhaseSpace phasespace(k1, k2, theta12, _UVcutoff, &kernels, PL, this);
+   phasespace.reflectphi = _reflectphi;
+
+   // integration by the loop integration method (VEGAS via cuba by default)
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(3);
+
+   // cached result
+   std::string key;
+   IntegralResults cached;
+   if (_cache) {
+      key = ResultCache::key("Bispectrum::oneLoop", _order, {k1, k2, theta12, static_cast<double>(_reflectphi)}, _UVcutoff, _diagrams.qmax(), kernels, PL, *integrator);
+      if (!_diagrams.profile() && _cache->find(key, cached)) { return cached[0]; }
+   }
+
+   IntegralResult result = integrator->integrate(oneLoop_integrand, &phasespace);
+   if (_cache) { _cache->store(key, result); }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+DiagramIntegrals Bispectrum::oneLoop_diagrams(double k1, double k2, double theta12, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, GridMode mode) const
+{
+   // integration method
+   LoopPhaseSpace phasespace(k1, k2, theta12, _UVcutoff, &kernels, PL, this);
+   phasespace.reflectphi = _reflectphi;
 
-   // VEGAS integration via cuba
-   VEGASintegrator vegas(3);
+   // integration by the loop integration method (VEGAS via cuba by default), a component or a run per diagram
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(3);
 
-   return vegas.integrate(oneLoop_integrand, &phasespace);
+   return integrator->integrate_diagrams(oneLoop_diagrams_integrand, &phasespace, &phasespace.diagram, _diagrams.names_oneLoop(), mode);
 }
    
 //------------------------------------------------------------------------------
@@ -65,6 +99,14 @@ double Bispectrum::treeEFT(double k1, double k2, double theta12, const LabelMap<
    return _EFTdiagrams.value_tree(momenta, kernels, PL);
 }
 
+//------------------------------------------------------------------------------
+EFTbasis Bispectrum::treeEFT_basis(double k1, double k2, double theta12, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   return EFTbasis::decompose(kernels, [&](const LabelMap<Vertex, KernelBase*>& unitkernels) {
+      return std::pair<double, double>(treeEFT(k1, k2, theta12, unitkernels, PL), 0.);
+   });
+}
+
 //------------------------------------------------------------------------------
 std::pair<double, LabelMap<Momentum, ThreeVector>* const> Bispectrum::LoopPhaseSpace::generate_point_oneLoop(std::vector<double> xpts)
 {
@@ -72,12 +114,15 @@ std::pair<double, LabelMap<Momentum, ThreeVector>* const> Bispectrum::LoopPhaseS
    // q components
    double qmag = xpts[0] * qmax;
    double qcosth = 2 * xpts[1] - 1.;
-   double qphi = 2*pi * xpts[2];
+   // k1 and k2 lie in the x-z plane, so the integrand is symmetric under
+   // the reflection y -> -y (phi -> 2pi - phi), and it is enough to
+   // sample phi in [0, pi] and count each point twice
+   double qphi = (reflectphi ? pi : 2*pi) * xpts[2];
 
    // jacobian
    // qmax from the magnitude integral,
    // 2 from the cos theta jacobian,
-   // pick up a 2pi from the phi integral,
+   // pick up a 2pi from the phi integral (pi times 2 from the reflection in the reduced mode),
    // and a 1/(2pi)^3 from the measure
    double jacobian = qmag * qmag * qmax / (2 * pi*pi);
 
@@ -101,11 +146,40 @@ int Bispectrum::oneLoop_integrand(const int *ndim, const double xx[], const int
    std::pair<double, LabelMap<Momentum, ThreeVector>* const> PSpoint = phasespace->generate_point_oneLoop(xpts);
 
    // calculate the integrand
-   double integrand = PSpoint.first * (phasespace->bispectrum->diagrams()->value_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL));
+   double integrand = PSpoint.first * (phasespace->bispectrum->diagrams()->value_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL, PSpoint.first));
 
    ff[0] = integrand;
 
    return 0;
 }
 
+//------------------------------------------------------------------------------
+int Bispectrum::oneLoop_diagrams_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata)
+{
+   // get the integrator
+   LoopPhaseSpace* phasespace = static_cast<LoopPhaseSpace*>(userdata);
+
+   // generate the PS point
+   std::vector<double> xpts;
+   for (int i = 0; i < phasespace->ndim; i++) {
+      xpts.push_back(xx[i]);
+   }
+   std::pair<double, LabelMap<Momentum, ThreeVector>* const> PSpoint = phasespace->generate_point_oneLoop(xpts);
+
+   // a single diagram, or the total followed by each diagram
+   const DiagramSetBase* diagrams = phasespace->bispectrum->diagrams();
+   if (phasespace->diagram >= 0) {
+      ff[0] = PSpoint.first * diagrams->value_oneLoop_diagram(phasespace->diagram, *(PSpoint.second), *(phasespace->kernels), phasespace->PL);
+   } else {
+      diagrams->values_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL, ff + 1);
+      ff[0] = 0;
+      for (int i = 1; i < *ncomp; i++) {
+         ff[i] *= PSpoint.first;
+         ff[0] += ff[i];
+      }
+   }
+
+   return 0;
+}
+
 } // namespace fnfast
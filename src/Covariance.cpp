@@ -25,9 +25,18 @@ namespace fnfast {
 //------------------------------------------------------------------------------
 /*DAN*/
 Covariance::Covariance(Order order)
-: _order(order), _diagrams(DiagramSet4pointSPT(_order)), _EFTdiagrams(DiagramSet4pointEFT(_EFTorder(_order))), _UVcutoff(10.)
+: _order(order), _diagrams(DiagramSet4pointSPT(_order)), _EFTdiagrams(DiagramSet4pointEFT(_EFTorder(_order))), _UVcutoff(10.), _seed(37), _method(IntegrationMethod::kVEGAS), _epsrel(1e-3), _maxeval(250000), _cache(nullptr)
 {}
 
+//------------------------------------------------------------------------------
+std::unique_ptr<IntegratorBase> Covariance::make_integrator(int ndim) const
+{
+   std::unique_ptr<IntegratorBase> integrator = IntegratorBase::create(_method, ndim, _seed, _epsrel, _maxeval, _statefile);
+   // the profile is recorded in the integrand, which must not run in Cuba's worker processes
+   integrator->serial = (_diagrams.profile() != nullptr);
+   return integrator;
+}
+
 //------------------------------------------------------------------------------
 IntegralResult Covariance::tree(double k, double kprime, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
 {
@@ -35,10 +44,10 @@ IntegralResult Covariance::tree(double k, double kprime, const LabelMap<Vertex,
    PhaseSpace phasespace(k, kprime, _UVcutoff, &kernels, PL, this);
    phasespace.ndim = 1;
 
-   // VEGAS integration via cuba
-   VEGASintegrator vegas(phasespace.ndim);
+   // integration by the loop integration method (VEGAS via cuba by default)
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(phasespace.ndim);
 
-   return vegas.integrate(tree_integrand, &phasespace);
+   return integrator->integrate(tree_integrand, &phasespace);
 }
 
 //------------------------------------------------------------------------------
@@ -87,10 +96,34 @@ IntegralResult Covariance::oneLoop(double k, double kprime, const LabelMap<Verte
    PhaseSpace phasespace(k, kprime, _UVcutoff, &kernels, PL, this);
    phasespace.ndim = 4;
 
-   // VEGAS integration via cuba
-   VEGASintegrator vegas(phasespace.ndim);
+   // integration by the loop integration method (VEGAS via cuba by default)
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(phasespace.ndim);
+
+   // cached result
+   std::string key;
+   IntegralResults cached;
+   if (_cache) {
+      key = ResultCache::key("Covariance::oneLoop", _order, {k, kprime}, _UVcutoff, _diagrams.qmax(), kernels, PL, *integrator);
+      if (!_diagrams.profile() && _cache->find(key, cached)) { return cached[0]; }
+   }
+
+   IntegralResult result = integrator->integrate(oneLoop_integrand, &phasespace);
+   if (_cache) { _cache->store(key, result); }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+DiagramIntegrals Covariance::oneLoop_diagrams(double k, double kprime, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, GridMode mode) const
+{
+   // integration method
+   PhaseSpace phasespace(k, kprime, _UVcutoff, &kernels, PL, this);
+   phasespace.ndim = 4;
+
+   // integration by the loop integration method (VEGAS via cuba by default), a component or a run per diagram
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(phasespace.ndim);
 
-   return vegas.integrate(oneLoop_integrand, &phasespace);
+   return integrator->integrate_diagrams(oneLoop_diagrams_integrand, &phasespace, &phasespace.diagram, _diagrams.names_oneLoop(), mode);
 }
    
    
@@ -103,10 +136,19 @@ IntegralResult Covariance::treeEFT(double k, double kprime, const LabelMap<Verte
    PhaseSpace phasespace(k, kprime, _UVcutoff, &kernels, PL, this);
    phasespace.ndim = 1;
       
-   // VEGAS integration via cuba
-   VEGASintegrator vegas(phasespace.ndim);
-      
-   return vegas.integrate(treeEFT_integrand, &phasespace);
+   // integration by the loop integration method (VEGAS via cuba by default)
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(phasespace.ndim);
+
+   return integrator->integrate(treeEFT_integrand, &phasespace);
+}
+
+//------------------------------------------------------------------------------
+EFTbasis Covariance::treeEFT_basis(double k, double kprime, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   return EFTbasis::decompose(kernels, [&](const LabelMap<Vertex, KernelBase*>& unitkernels) {
+      IntegralResult result = treeEFT(k, kprime, unitkernels, PL);
+      return std::pair<double, double>(result.result, result.error);
+   });
 }
 //------------------------------------------------------------------------------
 /*DAN*/
@@ -174,11 +216,40 @@ int Covariance::oneLoop_integrand(const int *ndim, const double xx[], const int
    std::pair<double, LabelMap<Momentum, ThreeVector>* const> PSpoint = phasespace->generate_point_oneLoop(xpts);
 
    // calculate the integrand
-   double integrand = PSpoint.first * (phasespace->covariance->diagrams()->value_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL));
+   double integrand = PSpoint.first * (phasespace->covariance->diagrams()->value_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL, PSpoint.first));
 
    ff[0] = integrand;
 
    return 0;
 }
 
+//------------------------------------------------------------------------------
+int Covariance::oneLoop_diagrams_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata)
+{
+   // get the integrator
+   PhaseSpace* phasespace = static_cast<PhaseSpace*>(userdata);
+
+   // generate the PS point
+   std::vector<double> xpts;
+   for (int i = 0; i < phasespace->ndim; i++) {
+      xpts.push_back(xx[i]);
+   }
+   std::pair<double, LabelMap<Momentum, ThreeVector>* const> PSpoint = phasespace->generate_point_oneLoop(xpts);
+
+   // a single diagram, or the total followed by each diagram
+   const DiagramSetBase* diagrams = phasespace->covariance->diagrams();
+   if (phasespace->diagram >= 0) {
+      ff[0] = PSpoint.first * diagrams->value_oneLoop_diagram(phasespace->diagram, *(PSpoint.second), *(phasespace->kernels), phasespace->PL);
+   } else {
+      diagrams->values_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL, ff + 1);
+      ff[0] = 0;
+      for (int i = 1; i < *ncomp; i++) {
+         ff[i] *= PSpoint.first;
+         ff[0] += ff[i];
+      }
+   }
+
+   return 0;
+}
+
 } // namespace fnfast
@@ -19,13 +19,19 @@
 #include <iostream>
 #include <limits>
 #include <algorithm>
+#include <sstream>
+#include <unordered_set>
 
 #include "DiagramBase.hpp"
 
 namespace fnfast {
 
 //------------------------------------------------------------------------------
-DiagramBase::DiagramBase(std::vector<Line> lines) : _lines(lines)
+std::unordered_map<std::string, std::vector<std::vector<int> > > DiagramBase::_permcache;
+std::mutex DiagramBase::_permcachemutex;
+
+//------------------------------------------------------------------------------
+DiagramBase::DiagramBase(std::vector<Line> lines) : _lines(lines), _compiled(false)
 {
    // construct the vertex momenta map
    std::unordered_map<Vertex, std::vector<Propagator> > vx_momenta;
@@ -66,11 +72,12 @@ DiagramBase::DiagramBase(std::vector<Line> lines) : _lines(lines)
    _symfac = calc_symmetry_factor();
 
    // calculate the permutations of the external momenta
-   _perms = calc_permutations();
+   _permindices = calc_permutations();
+   for (auto& indices : _permindices) { _perms.push_back(perm_labelmap(indices)); }
 }
 
 //------------------------------------------------------------------------------
-DiagramBase::DiagramBase(std::vector<Line> lines, LabelMap<Vertex, VertexType> vertextypes) : _lines(lines), _vertextypes(vertextypes)
+DiagramBase::DiagramBase(std::vector<Line> lines, LabelMap<Vertex, VertexType> vertextypes) : _lines(lines), _vertextypes(vertextypes), _compiled(false)
 {
    // construct the vertex momenta map
    std::unordered_map<Vertex, std::vector<Propagator> > vx_momenta;
@@ -104,11 +111,12 @@ DiagramBase::DiagramBase(std::vector<Line> lines, LabelMap<Vertex, VertexType> v
    _symfac = calc_symmetry_factor();
 
    // calculate the permutations of the external momenta
-   _perms = calc_permutations();
+   _permindices = calc_permutations();
+   for (auto& indices : _permindices) { _perms.push_back(perm_labelmap(indices)); }
 }
 
 //------------------------------------------------------------------------------
-DiagramBase::DiagramBase(std::vector<Line> lines, LabelMap<Vertex, VertexType> vertextypes, LabelMap<Vertex, KernelType> kerneltypes) : _lines(lines), _vertextypes(vertextypes), _kerneltypes(kerneltypes)
+DiagramBase::DiagramBase(std::vector<Line> lines, LabelMap<Vertex, VertexType> vertextypes, LabelMap<Vertex, KernelType> kerneltypes) : _lines(lines), _vertextypes(vertextypes), _kerneltypes(kerneltypes), _compiled(false)
 {
    // construct the vertex momenta map
    std::unordered_map<Vertex, std::vector<Propagator> > vx_momenta;
@@ -135,7 +143,8 @@ DiagramBase::DiagramBase(std::vector<Line> lines, LabelMap<Vertex, VertexType> v
    _symfac = calc_symmetry_factor();
 
    // calculate the permutations of the external momenta
-   _perms = calc_permutations();
+   _permindices = calc_permutations();
+   for (auto& indices : _permindices) { _perms.push_back(perm_labelmap(indices)); }
 }
 
 //------------------------------------------------------------------------------
@@ -188,72 +197,107 @@ double DiagramBase::calc_symmetry_factor()
 }
 
 //------------------------------------------------------------------------------
-std::vector<LabelMap<Momentum, Momentum> > DiagramBase::calc_permutations()
+void DiagramBase::set_perms(std::vector<LabelMap<Momentum, Momentum> > perms)
+{
+   _perms = perms;
+   // any compiled vertex calls refer to the old permutations
+   _compiled = false;
+   // translate the label maps into index arrays
+   _permindices.clear();
+   for (auto& perm : _perms) {
+      std::vector<int> indices(_extmomlabels.size(), 0);
+      for (size_t i = 0; i < _extmomlabels.size(); i++) {
+         Momentum target = perm[_extmomlabels[i]];
+         indices[i] = std::find(_extmomlabels.begin(), _extmomlabels.end(), target) - _extmomlabels.begin();
+      }
+      _permindices.push_back(indices);
+   }
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::vector<int> > DiagramBase::calc_permutations()
 {
    /*
     * Calculation of the external momentum permutations.
     * Returns the set of permutations needed to correctly sum over all
     * external momentum routings of the graph.
     * Eliminates degenerate configurations.
-    * The permutations are stored as a map of momentum label mappings.
+    * The permutations are stored as index arrays: permutation i maps
+    * momentum label _extmomlabels[j] to _extmomlabels[perm[i][j]].
+    * The result only depends on the labeled topology, so it is cached
+    * (keyed by the canonical encoding of the topology) and shared
+    * between all diagrams with the same topology.
     */
-   std::vector<LabelMap<Momentum, Momentum> > perms;
-   int nperm = 0;
+   std::vector<int> indices;
+   for (size_t i = 0; i < _vertices.size(); i++) { indices.push_back(i); }
 
-   // create a list of VertexPair objects, where each represents
-   // a distinct relabeling of the vertices (and hence a permutation of external momenta).
-   // We will iterate over vertex labeling permutations and store only those
-   // which will give a unique diagram value.
-   std::vector<std::vector<VertexObjectPair> > vertexconnections;
+   // check the cache first
+   std::string key = topology_key(indices);
+   std::lock_guard<std::mutex> lock(_permcachemutex);
+   auto cached = _permcache.find(key);
+   if (cached != _permcache.end()) { return cached->second; }
+
+   std::vector<std::vector<int> > perms;
+
+   // The encoded (sorted) list of lines of each relabeled graph;
+   // a vertex relabeling giving an encoding we have already seen
+   // would give the same diagram value and is dropped.
+   std::unordered_set<std::string> vertexconnections;
 
    // Loop over vertex permutations.
    // Since we will be applying the same permutation to momentum labels and vertex labels,
    // we index permutations with a simple list of integers
-   std::vector<int> indices;
-   for (size_t i = 0; i < _vertices.size(); i++) { indices.push_back(i); }
-   // make sure it's sorted...
-   std::sort(indices.begin(), indices.end());
-   // main permutation loop
    do {
-      // create a map from the canonical vertex labels to the permuted ones
-      std::unordered_map<Vertex, Vertex> vertexmap;
-      for (size_t i = 0; i < _vertices.size(); i++) {
-         vertexmap[_vertices[i]] = _vertices[indices[i]];
-      }
-
-      // use this map to create a vector of VertexObjectPair objects for each line
-      // that are the diagram lines under the vertex permutation
-      std::vector<VertexObjectPair> vertexpairs;
-      for (auto line : _lines) {
-         // store the vertex pairs for each line
-         Vertex vxstart = vertexmap[line.start];
-         Vertex vxend = vertexmap[line.end];
-         vertexpairs.push_back(VertexObjectPair(vxstart, vxend, _vertextypes[vxstart], _vertextypes[vxend], _kerneltypes[vxstart], _kerneltypes[vxend]));
-      }
-      // now sort this object and compare it to existing ones
-      // to find unique permutations
-      std::sort(vertexpairs.begin(), vertexpairs.end());
-
-      bool newitem = true;
-      for (auto vxconn : vertexconnections) {
-         if (vertexpairs == vxconn) { newitem = false; break; }
-      }
-
       // if we have encountered a new ordering, add it to the list
-      // and save the permutation in terms of the momentum labels map
-      if (newitem) {
-         nperm++;
-         vertexconnections.push_back(vertexpairs);
-         // create the map for the momentum labels (as we did for the vertices)
-         std::unordered_map<Momentum, Momentum> extmommap;
-         for (size_t i = 0; i < _vertices.size(); i++) {
-            extmommap[_extmomlabels[i]] = _extmomlabels[indices[i]];
-         }
-         perms.push_back(LabelMap<Momentum, Momentum>(extmommap));
+      if (vertexconnections.insert(topology_key(indices)).second) {
+         perms.push_back(indices);
       }
    } while (std::next_permutation(indices.begin(), indices.end()));
 
+   _permcache[key] = perms;
+
    return perms;
 }
 
+//------------------------------------------------------------------------------
+std::string DiagramBase::topology_key(const std::vector<int>& indices)
+{
+   // create a map from the canonical vertex labels to the permuted ones
+   std::unordered_map<Vertex, Vertex> vertexmap;
+   for (size_t i = 0; i < _vertices.size(); i++) {
+      vertexmap[_vertices[i]] = _vertices[indices[i]];
+   }
+
+   // encode each line under the relabeling: the (unordered) vertex pair
+   // followed by the vertex and kernel types at the start and end of the line
+   std::vector<std::vector<int> > lines;
+   for (auto line : _lines) {
+      Vertex vxstart = vertexmap[line.start];
+      Vertex vxend = vertexmap[line.end];
+      lines.push_back(std::vector<int> {static_cast<int>(std::min(vxstart, vxend)), static_cast<int>(std::max(vxstart, vxend)),
+                                        static_cast<int>(_vertextypes[vxstart]), static_cast<int>(_vertextypes[vxend]),
+                                        static_cast<int>(_kerneltypes[vxstart]), static_cast<int>(_kerneltypes[vxend])});
+   }
+   // sort so that the encoding does not depend on the order of the lines
+   std::sort(lines.begin(), lines.end());
+
+   std::stringstream ss;
+   ss << _vertices.size() << ":";
+   for (auto& line : lines) {
+      for (auto entry : line) { ss << entry << ","; }
+      ss << ";";
+   }
+   return ss.str();
+}
+
+//------------------------------------------------------------------------------
+LabelMap<Momentum, Momentum> DiagramBase::perm_labelmap(const std::vector<int>& indices) const
+{
+   std::unordered_map<Momentum, Momentum> extmommap;
+   for (size_t i = 0; i < indices.size(); i++) {
+      extmommap[_extmomlabels[i]] = _extmomlabels[indices[i]];
+   }
+   return LabelMap<Momentum, Momentum>(extmommap);
+}
+
 } // namespace fnfast
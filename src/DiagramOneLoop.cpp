@@ -47,6 +47,7 @@ DiagramOneLoop::DiagramOneLoop(std::vector<Line> lines) : DiagramBase(lines), _q
       }
    }
    assert(isLoop && !is2Loop);
+   split_loop_dependence();
 }
 
 //------------------------------------------------------------------------------
@@ -73,6 +74,7 @@ DiagramOneLoop::DiagramOneLoop(std::vector<Line> lines, LabelMap<Vertex, VertexT
       }
    }
    assert(isLoop && !is2Loop);
+   split_loop_dependence();
 }
 
 //------------------------------------------------------------------------------
@@ -99,27 +101,51 @@ DiagramOneLoop::DiagramOneLoop(std::vector<Line> lines, LabelMap<Vertex, VertexT
       }
    }
    assert(isLoop && !is2Loop);
+   split_loop_dependence();
 }
 
 //------------------------------------------------------------------------------
-double DiagramOneLoop::value_base(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+void DiagramOneLoop::split_loop_dependence()
 {
-   // check to see if the loop momentum is above the cutoff, if so return 0
-   if (mom[Momentum::q].magnitude() > _qmax) { return 0; }
+   // lines carrying the loop momentum have to be recomputed for every
+   // loop momentum routing, the others only depend on the external momenta
+   for (auto line : _lines) {
+      if (line.propagator.hasLabel(Momentum::q)) {
+         _looplines.push_back(line);
+      } else {
+         _extlines.push_back(line);
+      }
+   }
+   // same for the vertices: a vertex depends on the loop momentum
+   // if any of the propagators attached to it does
+   for (auto vertex : _vertices) {
+      bool hasLoop = false;
+      for (auto vx_prop : _vertexmomenta[vertex]) {
+         if (vx_prop.hasLabel(Momentum::q)) { hasLoop = true; }
+      }
+      if (hasLoop) {
+         _loopvertices.push_back(vertex);
+      } else {
+         _extvertices.push_back(vertex);
+      }
+   }
+}
 
-   // the diagram value is:
-   // symmetry factor * propagators * vertices
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value_external(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
    double value = _symfac;
    // iterate over lines
-   for (auto line : _lines) {
+   for (auto& line : _extlines) {
       value *= (*PL)(line.propagator.p(mom).magnitude());
    }
    // now do vertex factors
-   for (auto vertex : _vertices) {
+   for (auto vertex : _extvertices) {
+      const std::vector<Propagator>& vx_props = _vertexmomenta[vertex];
       std::vector<ThreeVector> p;
-      p.reserve(_vertexmomenta[vertex].size());
+      p.reserve(vx_props.size());
       // loop over propagators attached to the vertex
-      for (auto vx_prop : _vertexmomenta[vertex]) {
+      for (auto& vx_prop : vx_props) {
          p.push_back(vx_prop.p(mom));
       }
       if (_kerneltypes[vertex] == KernelType::delta) {
@@ -132,18 +158,69 @@ double DiagramOneLoop::value_base(const LabelMap<Momentum, ThreeVector>& mom, co
 }
 
 //------------------------------------------------------------------------------
-double DiagramOneLoop::value_base_IRreg(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+double DiagramOneLoop::value_loop(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   // check to see if the loop momentum is above the cutoff, if so return 0
+   if (mom.q().magnitude() > _qmax) { return 0; }
+
+   double value = 1;
+   // iterate over lines
+   for (auto& line : _looplines) {
+      value *= (*PL)(line.propagator.p(mom).magnitude());
+   }
+   // now do vertex factors
+   for (auto vertex : _loopvertices) {
+      const std::vector<Propagator>& vx_props = _vertexmomenta[vertex];
+      std::vector<ThreeVector> p;
+      p.reserve(vx_props.size());
+      // loop over propagators attached to the vertex
+      for (auto& vx_prop : vx_props) {
+         p.push_back(vx_prop.p(mom));
+      }
+      if (_kerneltypes[vertex] == KernelType::delta) {
+         value *= kernels[vertex]->Fn_sym(p);
+      } else {
+         value *= kernels[vertex]->Gn_sym(p);
+      }
+   }
+   return value;
+}
+
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value_base(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   return value_base(MomentumView(flatmom, MomentumView::identity()), kernels, PL);
+}
+
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value_base(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   // check to see if the loop momentum is above the cutoff, if so return 0
+   if (mom.q().magnitude() > _qmax) { return 0; }
+
+   // the diagram value is:
+   // symmetry factor * propagators * vertices
+   return value_external(mom, kernels, PL) * value_loop(mom, kernels, PL);
+}
+
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value_loop_IRreg(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
 {
    // no IR regulation necessary if there are no poles away from q = 0
-   if (_IRpoles.empty()) return value_base(mom, kernels, PL);
+   if (_IRpoles.empty()) return value_loop(mom, kernels, PL);
 
    // To regulate the diagram in the IR, we map each region with
    // an IR pole at q = qIR != 0 onto coordinates with the pole at q = 0
+   // The shift only touches the loop momentum, so only the loop dependent
+   // factors of the diagram need to be recomputed in each region
    double value = 0;
    // need to regulate only the unique IR poles
    // e.g. in the covariance limit, two IR poles can be degenerate
    // and we should treat them simultaneously
    std::vector<ThreeVector> uniqueIRpoles;
+   uniqueIRpoles.reserve(_IRpoles.size() + 1);
    // pole at q = 0
    uniqueIRpoles.push_back(ThreeVector(0, 0, 0));
    // loop over the nonzero poles
@@ -151,7 +228,7 @@ double DiagramOneLoop::value_base_IRreg(const LabelMap<Momentum, ThreeVector>& m
       // check if pole is unique
       bool is_unique = true;
       ThreeVector pole = pole_prop.p(mom);
-      for (auto unique_pole : uniqueIRpoles) {
+      for (auto& unique_pole : uniqueIRpoles) {
          if (pole == unique_pole) {
             is_unique = false;
             break;
@@ -163,25 +240,42 @@ double DiagramOneLoop::value_base_IRreg(const LabelMap<Momentum, ThreeVector>& m
    for (size_t i = 0; i < uniqueIRpoles.size(); i++) {
       // for these poles we change variables: q -> q + pole
       // so that the pole maps to 0 and we exclude all other poles
-      ThreeVector pole = uniqueIRpoles[i];
+      const ThreeVector& pole = uniqueIRpoles[i];
       double PSregion = 1;
       // loop over all other poles and make PS cuts for each
       for (size_t j = 0; j < uniqueIRpoles.size(); j++) {
          if (j != i) {
-            ThreeVector pole_j = uniqueIRpoles[j];
-            PSregion *= theta(mom[Momentum::q], mom[Momentum::q] + pole - pole_j);
+            PSregion *= theta(mom.q(), mom.q() + pole - uniqueIRpoles[j]);
          }
       }
-      // copy and shift the diagram momentum for the pole
-      LabelMap<Momentum, ThreeVector> mom_shift = mom;
-      mom_shift[Momentum::q] = mom[Momentum::q] + pole;
+      // no need to evaluate anything outside of the region
+      if (PSregion == 0) { continue; }
+      // shift the loop momentum in the view for the pole
+      MomentumView mom_shift = mom;
+      mom_shift.set_q(mom.q() + pole);
       // add the diagram value for this shifted momentum, times the PS factor
-      value += PSregion * value_base(mom_shift, kernels, PL);
+      value += PSregion * value_loop(mom_shift, kernels, PL);
    }
 
    return value;
 }
 
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value_base_IRreg(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   return value_base_IRreg(MomentumView(flatmom, MomentumView::identity()), kernels, PL);
+}
+
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value_base_IRreg(const MomentumView& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   // the IR regulation only shifts the loop momentum,
+   // so the external factors are common to all regions
+   return value_external(mom, kernels, PL) * value_loop_IRreg(mom, kernels, PL);
+}
+
 //------------------------------------------------------------------------------
 double DiagramOneLoop::value(const LabelMap<Momentum, ThreeVector>& mom, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
 {
@@ -191,22 +285,175 @@ double DiagramOneLoop::value(const LabelMap<Momentum, ThreeVector>& mom, const L
     * over external momentum configurations.
     * To make the symmetrization more efficient, we compute only the
     * momentum configurations giving distinct diagram values,
-    * and multiply each by the appropriate symmetry factor
+    * and multiply each by the appropriate symmetry factor.
+    * The propagators and vertices that do not depend on the loop momentum
+    * are shared between q and -q (and all IR regions), so they are
+    * evaluated once per permutation.
+    * The momenta are copied once into a flat array; permutations, q -> -q
+    * and the IR shifts are applied through a MomentumView on that array.
     */
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   int indices[MomentumView::kNumSlots];
 
    double value = 0;
    // loop over external momentum permutations
    // symmetrize over q -> -q
-   for (auto perm : _perms) {
-      LabelMap<Momentum, ThreeVector> mom_perm = mom;
-      mom_perm.permute(perm);
-      value += 0.5 * value_base_IRreg(mom_perm, kernels, PL);
-      ThreeVector mq = -1 * mom_perm[Momentum::q];
-      mom_perm[Momentum::q] = mq;
-      value += 0.5 * value_base_IRreg(mom_perm, kernels, PL);
+   for (auto& perm : _permindices) {
+      // index indirection for the permuted external momenta
+      perm_slots(perm, indices);
+      MomentumView mom_perm(flatmom, indices);
+      double extvalue = value_external(mom_perm, kernels, PL);
+      if (extvalue == 0) { continue; }
+      double loopvalue = value_loop_IRreg(mom_perm, kernels, PL);
+      mom_perm.set_q(-1 * mom_perm.q());
+      loopvalue += value_loop_IRreg(mom_perm, kernels, PL);
+      value += 0.5 * extvalue * loopvalue;
    }
 
    return value;
 }
 
+//------------------------------------------------------------------------------
+void DiagramOneLoop::compile(KernelDAG& dag)
+{
+   /*
+    * Register every propagator and vertex evaluated by value():
+    * for each permutation of the external momenta, the loop independent
+    * factors, and the loop dependent factors for each routing
+    * q -> +-q + pole of the loop momentum (pole = 0 or one of the IR poles).
+    * Which IR regions contribute is only known numerically (poles can be
+    * degenerate), so all routings are compiled and picked at evaluation.
+    */
+   _dagperms.clear();
+   int indices[MomentumView::kNumSlots];
+   for (auto& perm : _permindices) {
+      perm_slots(perm, indices);
+      CompiledPerm compiled;
+      for (auto& line : _extlines) {
+         compiled.extlines.push_back(dag.add_momentum(KernelDAG::combination(line.propagator, indices)));
+      }
+      for (auto vertex : _extvertices) {
+         std::vector<KernelDAG::Combination> p;
+         for (auto& vx_prop : _vertexmomenta[vertex]) {
+            p.push_back(KernelDAG::combination(vx_prop, indices));
+         }
+         compiled.extvertices.push_back(dag.add_kernel(_kerneltypes[vertex], p));
+      }
+      // the zero pole, then the nonzero IR poles
+      std::vector<KernelDAG::Combination> poles(1, KernelDAG::Combination());
+      poles[0].fill(0);
+      for (auto& pole_prop : _IRpoles) {
+         poles.push_back(KernelDAG::combination(pole_prop, indices));
+         compiled.poles.push_back(dag.add_momentum(poles.back()));
+      }
+      for (auto& pole : poles) {
+         compiled.routings.push_back(compile_routing(dag, indices, 1, pole));
+         compiled.routings.push_back(compile_routing(dag, indices, -1, pole));
+      }
+      _dagperms.push_back(compiled);
+   }
+   _compiled = true;
+}
+
+//------------------------------------------------------------------------------
+DiagramOneLoop::LoopRouting DiagramOneLoop::compile_routing(KernelDAG& dag, const int* indices, int qsign, const KernelDAG::Combination& pole) const
+{
+   LoopRouting routing;
+   KernelDAG::Combination q = pole;
+   q[MomentumView::slot(Momentum::q)] += qsign;
+   routing.q = dag.add_momentum(q);
+   for (auto& line : _looplines) {
+      routing.lines.push_back(dag.add_momentum(KernelDAG::combination(line.propagator, indices, qsign, pole)));
+   }
+   for (auto vertex : _loopvertices) {
+      std::vector<KernelDAG::Combination> p;
+      for (auto& vx_prop : _vertexmomenta[vertex]) {
+         p.push_back(KernelDAG::combination(vx_prop, indices, qsign, pole));
+      }
+      routing.vertices.push_back(dag.add_kernel(_kerneltypes[vertex], p));
+   }
+   return routing;
+}
+
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value_loop(const LoopRouting& routing, KernelDAG::Evaluation& eval, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   // check to see if the loop momentum is above the cutoff, if so return 0
+   if (eval.momentum(routing.q).magnitude() > _qmax) { return 0; }
+
+   double value = 1;
+   for (auto line : routing.lines) {
+      value *= eval.linear_power(line, PL);
+   }
+   for (size_t i = 0; i < _loopvertices.size(); i++) {
+      value *= eval.kernel(routing.vertices[i], kernels[_loopvertices[i]]);
+   }
+   return value;
+}
+
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value_loop_IRreg(const CompiledPerm& perm, int qsign, KernelDAG::Evaluation& eval, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   // same as value_loop_IRreg(mom, ...), with the routings looked up in the DAG
+   int sign = (qsign > 0) ? 0 : 1;
+   if (_IRpoles.empty()) return value_loop(perm.routings[sign], eval, kernels, PL);
+
+   // unique IR poles, as indices into the compiled poles (0 is the pole at q = 0)
+   std::vector<size_t> uniqueIRpoles;
+   std::vector<ThreeVector> uniquepoles;
+   uniqueIRpoles.reserve(_IRpoles.size() + 1);
+   uniquepoles.reserve(_IRpoles.size() + 1);
+   uniqueIRpoles.push_back(0);
+   uniquepoles.push_back(ThreeVector(0, 0, 0));
+   for (size_t i = 0; i < perm.poles.size(); i++) {
+      const ThreeVector& pole = eval.momentum(perm.poles[i]);
+      bool is_unique = true;
+      for (auto& unique_pole : uniquepoles) {
+         if (pole == unique_pole) {
+            is_unique = false;
+            break;
+         }
+      }
+      if (is_unique) {
+         uniqueIRpoles.push_back(i + 1);
+         uniquepoles.push_back(pole);
+      }
+   }
+   const ThreeVector& q = eval.momentum(perm.routings[sign].q);
+   double value = 0;
+   for (size_t i = 0; i < uniquepoles.size(); i++) {
+      double PSregion = 1;
+      for (size_t j = 0; j < uniquepoles.size(); j++) {
+         if (j != i) {
+            PSregion *= theta(q, q + uniquepoles[i] - uniquepoles[j]);
+         }
+      }
+      if (PSregion == 0) { continue; }
+      value += PSregion * value_loop(perm.routings[2 * uniqueIRpoles[i] + sign], eval, kernels, PL);
+   }
+   return value;
+}
+
+//------------------------------------------------------------------------------
+double DiagramOneLoop::value(KernelDAG::Evaluation& eval, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   // same as value(mom, ...), with the momenta, propagators and
+   // vertex factors of each permutation looked up in the DAG
+   double value = 0;
+   for (auto& perm : _dagperms) {
+      double extvalue = _symfac;
+      for (auto line : perm.extlines) {
+         extvalue *= eval.linear_power(line, PL);
+      }
+      for (size_t i = 0; i < _extvertices.size(); i++) {
+         extvalue *= eval.kernel(perm.extvertices[i], kernels[_extvertices[i]]);
+      }
+      if (extvalue == 0) { continue; }
+      double loopvalue = value_loop_IRreg(perm, 1, eval, kernels, PL) + value_loop_IRreg(perm, -1, eval, kernels, PL);
+      value += 0.5 * extvalue * loopvalue;
+   }
+   return value;
+}
+
 } // namespace fnfast
@@ -0,0 +1,117 @@
+//------------------------------------------------------------------------------
+/// \file DiagramProfile.cpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Implementation of class DiagramProfile
+//------------------------------------------------------------------------------
+
+#include <iomanip>
+#include <sstream>
+
+#include "DiagramProfile.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+void DiagramProfile::reset()
+{
+   _entries.clear();
+   _index.clear();
+   _npoints = 0;
+   _sum = 0;
+   _sum2 = 0;
+   _point.clear();
+}
+
+//------------------------------------------------------------------------------
+void DiagramProfile::add(const DiagramBase* diagram, const std::string& name, double value, double time, int kernel_calls)
+{
+   auto it = _index.find(diagram);
+   if (it == _index.end()) {
+      it = _index.insert(std::make_pair(diagram, _entries.size())).first;
+      _entries.push_back(Entry());
+      _entries.back().name = name;
+   }
+   Entry& entry = _entries[it->second];
+   entry.calls++;
+   entry.kernel_calls += kernel_calls;
+   entry.time += time;
+   _point.push_back(std::make_pair(it->second, _weight * value));
+}
+
+//------------------------------------------------------------------------------
+void DiagramProfile::end_point()
+{
+   double total = 0;
+   for (auto& value : _point) { total += value.second; }
+   for (auto& value : _point) {
+      Entry& entry = _entries[value.first];
+      entry.sum += value.second;
+      entry.sum2 += value.second * value.second;
+      entry.sumtotal += value.second * total;
+   }
+   _sum += total;
+   _sum2 += total * total;
+   _npoints++;
+   _point.clear();
+}
+
+//------------------------------------------------------------------------------
+double DiagramProfile::variance() const
+{
+   if (_npoints == 0) { return 0; }
+   double mean = _sum / _npoints;
+   return _sum2 / _npoints - mean * mean;
+}
+
+//------------------------------------------------------------------------------
+double DiagramProfile::variance(const Entry& entry) const
+{
+   if (_npoints == 0) { return 0; }
+   return entry.sumtotal / _npoints - (entry.sum / _npoints) * (_sum / _npoints);
+}
+
+//------------------------------------------------------------------------------
+std::string DiagramProfile::summary() const
+{
+   double time = 0;
+   for (auto& entry : _entries) { time += entry.time; }
+   double var = variance();
+
+   std::ostringstream out;
+   out << _npoints << " points, " << time << " s in the diagrams" << std::endl;
+   out << std::left << std::setw(10) << "diagram" << std::right
+       << std::setw(12) << "calls"
+       << std::setw(12) << "time [s]"
+       << std::setw(10) << "time %"
+       << std::setw(12) << "ns/call"
+       << std::setw(14) << "kernels/call"
+       << std::setw(14) << "mean"
+       << std::setw(12) << "var %" << std::endl;
+   for (auto& entry : _entries) {
+      double calls = (entry.calls > 0) ? entry.calls : 1;
+      out << std::left << std::setw(10) << entry.name << std::right
+          << std::setw(12) << entry.calls
+          << std::setw(12) << std::setprecision(4) << entry.time
+          << std::setw(10) << std::setprecision(3) << ((time > 0) ? 100 * entry.time / time : 0)
+          << std::setw(12) << std::setprecision(4) << 1e9 * entry.time / calls
+          << std::setw(14) << std::setprecision(3) << entry.kernel_calls / calls
+          << std::setw(14) << std::setprecision(5) << ((_npoints > 0) ? entry.sum / _npoints : 0)
+          << std::setw(12) << std::setprecision(3) << ((var > 0) ? 100 * variance(entry) / var : 0) << std::endl;
+   }
+
+   return out.str();
+}
+
+} // namespace fnfast
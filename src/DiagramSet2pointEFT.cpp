@@ -53,6 +53,10 @@ DiagramSet2pointEFT::DiagramSet2pointEFT(Order order, LabelMap<Vertex, KernelTyp
    // define the tree diagrams
    _tree = {P31x};
    _diagrams = LabelMap<Graphs_2point, DiagramBase*> {{Graphs_2point::P31x, P31x}};
+
+   // share the vertex kernel calls between the diagrams
+   set_names(_diagrams);
+   compile();
 }
 
 } // namespace fnfast
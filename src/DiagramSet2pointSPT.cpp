@@ -134,6 +134,10 @@ DiagramSet2pointSPT::DiagramSet2pointSPT(Order order, LabelMap<Vertex, KernelTyp
                                  {Graphs_2point::P51, P51}, {Graphs_2point::P42, P42}, {Graphs_2point::P33a, P33a}, {Graphs_2point::P33b, P33b}};
       }
    }
+
+   // share the vertex kernel calls between the diagrams
+   set_names(_diagrams);
+   compile();
 }
 
 } // namespace fnfast
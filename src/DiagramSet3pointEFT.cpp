@@ -69,6 +69,10 @@ DiagramSet3pointEFT::DiagramSet3pointEFT(Order order, LabelMap<Vertex, KernelTyp
    // define the tree diagrams
    _tree = {B411x, B321ax};
    _diagrams = LabelMap<Graphs_3point, DiagramBase*> {{Graphs_3point::B411x, B411x}, {Graphs_3point::B321ax, B321ax}};
+
+   // share the vertex kernel calls between the diagrams
+   set_names(_diagrams);
+   compile();
 }
 
 } // namespace fnfast
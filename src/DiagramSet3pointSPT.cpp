@@ -105,6 +105,10 @@ DiagramSet3pointSPT::DiagramSet3pointSPT(Order order, LabelMap<Vertex, KernelTyp
       _oneLoop = {B411, B321a, B321b, B222};
       _diagrams = LabelMap<Graphs_3point, DiagramBase*> {{Graphs_3point::B211, B211}, {Graphs_3point::B411, B411}, {Graphs_3point::B321a, B321a}, {Graphs_3point::B321b, B321b}, {Graphs_3point::B222, B222}};
    }
+
+   // share the vertex kernel calls between the diagrams
+   set_names(_diagrams);
+   compile();
 }
 
 } // namespace fnfast
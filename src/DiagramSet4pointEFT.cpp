@@ -106,6 +106,10 @@ DiagramSet4pointEFT::DiagramSet4pointEFT(Order order, LabelMap<Vertex, KernelTyp
    // define the tree diagrams
    _tree = {T5111x, T4211ax, T3311ax, T3221ax};
    _diagrams = LabelMap<Graphs_4point, DiagramBase*> {{Graphs_4point::T5111x, T5111x}, {Graphs_4point::T4211ax, T4211ax}, {Graphs_4point::T3311ax, T3311ax}, {Graphs_4point::T3221ax, T3221ax}};
+
+   // share the vertex kernel calls between the diagrams
+   set_names(_diagrams);
+   compile();
 }
 
 } // namespace fnfast
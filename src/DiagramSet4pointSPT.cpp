@@ -204,6 +204,10 @@ DiagramSet4pointSPT::DiagramSet4pointSPT(Order order, LabelMap<Vertex, KernelTyp
       _diagrams = LabelMap<Graphs_4point, DiagramBase*> {{Graphs_4point::T3111, T3111}, {Graphs_4point::T2211, T2211}, {Graphs_4point::T5111, T5111}, {Graphs_4point::T4211a, T4211a}, {Graphs_4point::T4211b, T4211b},
             {Graphs_4point::T3311a, T3311a}, {Graphs_4point::T3311b, T3311b}, {Graphs_4point::T3221a, T3221a}, {Graphs_4point::T3221b, T3221b}, {Graphs_4point::T3221c, T3221c}, {Graphs_4point::T2222, T2222}};
    }
+
+   // share the vertex kernel calls between the diagrams
+   set_names(_diagrams);
+   compile();
 }
 
 } // namespace fnfast
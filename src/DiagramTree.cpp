@@ -72,10 +72,10 @@ double DiagramTree::value(const LabelMap<Momentum, ThreeVector>& mom, const Labe
    // symmetry factor * propagators * vertices
    // summed over external momentum permutations
    double value = 0;
-   for (auto perm : _perms) {
+   LabelMap<Momentum, ThreeVector> mom_perm = mom;
+   for (auto& perm : _permindices) {
       // get the momentum permutation
-      LabelMap<Momentum, ThreeVector> mom_perm = mom;
-      mom_perm.permute(perm);
+      permute_momenta(mom, perm, mom_perm);
       double diagvalue = _symfac;
       // iterate over lines
       for (auto line : _lines) {
@@ -100,4 +100,47 @@ double DiagramTree::value(const LabelMap<Momentum, ThreeVector>& mom, const Labe
    return value;
 }
 
+//------------------------------------------------------------------------------
+void DiagramTree::compile(KernelDAG& dag)
+{
+   _daglines.clear();
+   _dagvertices.clear();
+   int indices[MomentumView::kNumSlots];
+   for (auto& perm : _permindices) {
+      perm_slots(perm, indices);
+      for (auto& line : _lines) {
+         _daglines.push_back(dag.add_momentum(KernelDAG::combination(line.propagator, indices)));
+      }
+      for (auto vertex : _vertices) {
+         std::vector<KernelDAG::Combination> p;
+         for (auto& vx_prop : _vertexmomenta[vertex]) {
+            p.push_back(KernelDAG::combination(vx_prop, indices));
+         }
+         _dagvertices.push_back(dag.add_kernel(_kerneltypes[vertex], p));
+      }
+   }
+   _compiled = true;
+}
+
+//------------------------------------------------------------------------------
+double DiagramTree::value(KernelDAG::Evaluation& eval, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   // same as value(mom, ...), with the momenta, propagators and
+   // vertex factors of each permutation looked up in the DAG
+   double value = 0;
+   size_t nlines = _lines.size();
+   size_t nvertices = _vertices.size();
+   for (size_t i = 0; i < _permindices.size(); i++) {
+      double diagvalue = _symfac;
+      for (size_t j = 0; j < nlines; j++) {
+         diagvalue *= eval.linear_power(_daglines[i * nlines + j], PL);
+      }
+      for (size_t j = 0; j < nvertices; j++) {
+         diagvalue *= eval.kernel(_dagvertices[i * nvertices + j], kernels[_vertices[j]]);
+      }
+      value += diagvalue;
+   }
+   return value;
+}
+
 } // namespace fnfast
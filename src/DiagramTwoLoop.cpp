@@ -185,9 +185,10 @@ double DiagramTwoLoop::value(const LabelMap<Momentum, ThreeVector>& mom, const L
    double value = 0;
    // loop over external momentum permutations
    // symmetrize over q -> -q
-   for (auto perm : _perms) {
-      LabelMap<Momentum, ThreeVector> mom_perm = mom;
-      mom_perm.permute(perm);
+   LabelMap<Momentum, ThreeVector> mom_perm = mom;
+   for (auto& perm : _permindices) {
+      permute_momenta(mom, perm, mom_perm);
+      mom_perm[Momentum::q] = mom[Momentum::q];
       value += 0.5 * value_base_IRreg(mom_perm, kernels, PL);
       ThreeVector mq = -1 * mom_perm[Momentum::q];
       mom_perm[Momentum::q] = mq;
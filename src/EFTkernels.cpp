@@ -29,7 +29,7 @@ namespace fnfast {
 //EFT coefficients
 //------------------------------------------------------------------------------
 
-std::string EFTcoefficients::description()
+std::string EFTcoefficients::description() const
 {
     std::stringstream stream;
 
@@ -47,22 +47,22 @@ std::string EFTcoefficients::description()
 //------------------------------------------------------------------------------
    
 //Recursion coefficients
-double EFTkernels::cF_E(int n)
+double EFTkernels::cF_E(int n) const
 {
     return (-2.) / (2 * n * n + 9 * n + 7);
 }
 
-double EFTkernels::cG_E(int n)
+double EFTkernels::cG_E(int n) const
 {
     return (-2*n - 4.) / (2 * n * n + 9 * n + 7);
 }
    
-double EFTkernels::cF_C(int n)
+double EFTkernels::cF_C(int n) const
 {
     return (2*n + 5.) / (2 * n * n + 9 * n + 7);
 }
 
-double EFTkernels::cG_C(int n)
+double EFTkernels::cG_C(int n) const
 {
     return 3. / (2 * n * n + 9 * n + 7);
 }
@@ -88,6 +88,36 @@ ThreeVector EFTkernels::betaOmega(const ThreeVector& p1, const ThreeVector& p2)
    return kernel;
 }
 
+//Vorticity EOM kernels, lane by lane, with the steps of the ones above
+//(the IR cutoff zeroes the lane)
+ThreeVectorBatch EFTkernels::alphaOmega(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2)
+{
+   double eps = 1e-12;
+   DoubleBatch p1p1 = p1*p1;
+   DoubleBatch factor;
+   for (int i = 0; i < kBatchWidth; i++) {
+      bool IR = !(p1p1[i] > eps);
+      factor[i] = IR ? 0. : 1. / (IR ? 1. : p1p1[i]);
+   }
+
+   return factor * crossProduct(p2,p1);
+}
+
+ThreeVectorBatch EFTkernels::betaOmega(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2)
+{
+   double eps = 1e-12;
+   DoubleBatch p1p1 = p1*p1;
+   DoubleBatch p2p2 = p2*p2;
+   DoubleBatch num = p2p2 + (2.*p1)*p2;
+   DoubleBatch factor;
+   for (int i = 0; i < kBatchWidth; i++) {
+      bool IR = !(p1p1[i] > eps && p2p2[i] > eps);
+      factor[i] = IR ? 0. : num[i] / (IR ? 1. : p1p1[i]*p2p2[i]);
+   }
+
+   return factor * crossProduct(p1,p2);
+}
+
 //------------------------------------------------------------------------------
 //Build Ftilde, Gtilde kernels in three steps. At each order:
 //1. Write shapes = k_i * tau_ij.
@@ -96,224 +126,230 @@ ThreeVector EFTkernels::betaOmega(const ThreeVector& p1, const ThreeVector& p2)
 //------------------------------------------------------------------------------
 
 //shapes = k_i * tau_ij
-//LO shapes
-std::vector<ThreeVector> EFTkernels::_LO_shapes(ThreeVector p)
-{
-    return(std::vector<ThreeVector> {p});
-}
-   
+//LO shape: p itself, see _tau(p1)
 //------------------------------------------------------------------------------
 //NLO shapes
-std::vector<ThreeVector> EFTkernels::_NLO_shapes(ThreeVector p1, ThreeVector p2)
+void EFTkernels::_NLO_shapes(const ThreeVector& p1, const ThreeVector& p2, ThreeVector* shapes)
 {
     double eps = 1e-12;
-    ThreeVector shape1(0.,0.,0.), shape2(0.,0.,0.), shape3(0.,0.,0.);
     ThreeVector p = p1+p2;
 
     //Shape1
-    shape1=p;
+    shapes[0]=p;
 
     //Shape2
-    if(p1*p1 > eps) shape2 = p*p1 / (p1*p1)* p1;
+    shapes[1].setToZero();
+    if(p1*p1 > eps) shapes[1] = p*p1 / (p1*p1)* p1;
 
     //Shape3
-    if(p1*p1 > eps && p2*p2 > eps) shape3 = (p*p1)*(p1*p2) / (2*(p1*p1)*(p2*p2)) * p2 + (p*p2)*(p1*p2) / (2*(p1*p1)*(p2*p2)) * p1;
-
-    return(std::vector<ThreeVector> {shape1,shape2,shape3});
+    shapes[2].setToZero();
+    if(p1*p1 > eps && p2*p2 > eps) shapes[2] = (p*p1)*(p1*p2) / (2*(p1*p1)*(p2*p2)) * p2 + (p*p2)*(p1*p2) / (2*(p1*p1)*(p2*p2)) * p1;
 }
    
 //------------------------------------------------------------------------------
 //NNLO shapes
-std::vector<ThreeVector> EFTkernels::_NNLO_shapes(ThreeVector p1, ThreeVector p2, ThreeVector p3)
+void EFTkernels::_NNLO_shapes(const ThreeVector& p1, const ThreeVector& p2, const ThreeVector& p3, ThreeVector* shapes)
 {
    double eps = 1e-12;
-   ThreeVector shape1(0.,0.,0.), shape2(0.,0.,0.), shape3(0.,0.,0.), shape4(0.,0.,0.), shape5(0.,0.,0.), shape6(0.,0.,0.), shape7(0.,0.,0.);
    ThreeVector p = p1+p2+p3;
+   for (int i = 1; i < 6; i++) shapes[i].setToZero();
 
    //Shape1, Shape2, Shape3
-   shape1 = p;
-   if(p1*p1 > eps) shape2 = p*p1 / (p1*p1)* p1;
-   if(p1*p1 > eps && p2*p2 > eps) shape3 = (p*p1)*(p1*p2) / (2*(p1*p1)*(p2*p2)) * p2 + (p*p2)*(p1*p2) / (2*(p1*p1)*(p2*p2)) * p1;
+   shapes[0] = p;
+   if(p1*p1 > eps) shapes[1] = p*p1 / (p1*p1)* p1;
+   if(p1*p1 > eps && p2*p2 > eps) shapes[2] = (p*p1)*(p1*p2) / (2*(p1*p1)*(p2*p2)) * p2 + (p*p2)*(p1*p2) / (2*(p1*p1)*(p2*p2)) * p1;
 
    
    //Shape4
-   if(p1*p1 > eps && p2*p2 > eps) shape4 = (p1*p2)*(p1*p2) / ((p1*p1)*(p2*p2)) * p;
+   if(p1*p1 > eps && p2*p2 > eps) shapes[3] = (p1*p2)*(p1*p2) / ((p1*p1)*(p2*p2)) * p;
    
    //Shape5
-   if(p1*p1 > eps && p2*p2 > eps && p3*p3 > eps) shape5 = (p2*p3)*(p2*p3)*(p*p1) / ((p1*p1)*(p2*p2)*(p3*p3)) * p1;
+   if(p1*p1 > eps && p2*p2 > eps && p3*p3 > eps) shapes[4] = (p2*p3)*(p2*p3)*(p*p1) / ((p1*p1)*(p2*p2)*(p3*p3)) * p1;
    
    //Shape6
-   if(p1*p1 > eps && p2*p2 > eps && p3*p3 > eps) shape6 = (p1*p3)*(p2*p3)*(p*p1) / (2*(p1*p1)*(p2*p2)*(p3*p3)) * p2 + (p1*p3)*(p2*p3)*(p*p2) / (2*(p1*p1)*(p2*p2)*(p3*p3)) * p1;
-   
-   return(std::vector<ThreeVector> {shape1,shape2,shape3,shape4,shape5,shape6});
+   if(p1*p1 > eps && p2*p2 > eps && p3*p3 > eps) shapes[5] = (p1*p3)*(p2*p3)*(p*p1) / (2*(p1*p1)*(p2*p2)*(p3*p3)) * p2 + (p1*p3)*(p2*p3)*(p*p2) / (2*(p1*p1)*(p2*p2)*(p3*p3)) * p1;
 }
    
 //------------------------------------------------------------------------------
 //tau = 1/(1+delta) * shapes
-ThreeVector EFTkernels::_tau(const std::vector<ThreeVector>& p)
+ThreeVector EFTkernels::_tau(const ThreeVector& p1)
 {
-   int n = p.size();
-   ThreeVector tau(0.,0.,0.);
-   
-   double cs =  (*_coefficients)[EFTcoefficients::cs];
-   std::vector<double> c = {(*_coefficients)[EFTcoefficients::c1],(*_coefficients)[EFTcoefficients::c2],(*_coefficients)[EFTcoefficients::c3]};
-   std::vector<double> t = {0.,(*_coefficients)[EFTcoefficients::t2],(*_coefficients)[EFTcoefficients::t3]};
-   std::vector<double> d = {(*_coefficients)[EFTcoefficients::d1],(*_coefficients)[EFTcoefficients::d2],(*_coefficients)[EFTcoefficients::d3],(*_coefficients)[EFTcoefficients::d4],(*_coefficients)[EFTcoefficients::d5],(*_coefficients)[EFTcoefficients::d6]};
-   
-   
-   //Handle trivial cases
-   if(n==0 || n>3) { return tau; }
-   
-   if(n==1) { ThreeVector p1 = p[0]; tau = cs*_LO_shapes(p1)[0]; }
-   
-   if(n==2) {
-      ThreeVector p1 = p[0];
-      ThreeVector p2 = p[1];
-      
-      std::vector<ThreeVector> P2={p2};
+   return _cs*p1;
+}
 
-      tau = cs*_sptkernels.Fn_sym({p1,p2})*_LO_shapes(p1+p2)[0]+_dot_product(c,_NLO_shapes(p1,p2))+_dot_product(t,_NLO_shapes(p1,p2))-_tau(P2);
-   }
-   
-   if(n==3) {
-      ThreeVector p1 = p[0];
-      ThreeVector p2 = p[1];
-      ThreeVector p3 = p[2];
-      
-      std::vector<ThreeVector> P23={p2,p3};
-      std::vector<ThreeVector> P3={p3};
-      
-      tau = cs*_sptkernels.Fn_sym({p1,p2,p3})*_LO_shapes(p1+p2+p3)[0]+_dot_product(c,_NLO_shapes(p1,p2+p3))*_sptkernels.Fn_sym({p2,p3})+_dot_product(c,_NLO_shapes(p1+p2,p3))*_sptkernels.Fn_sym({p1,p2})+_dot_product(t,_NLO_shapes(p1,p2+p3))*_sptkernels.Gn_sym({p2,p3})+_dot_product(t,_NLO_shapes(p1+p2,p3))*_sptkernels.Gn_sym({p1,p2})+_dot_product(d,_NNLO_shapes(p1,p2,p3))-_tau(P23)-_sptkernels.Fn_sym({p1,p2})*_tau(P3);
-   }
-   
-   return tau;
+ThreeVector EFTkernels::_tau(const ThreeVector& p1, const ThreeVector& p2, double F12)
+{
+   ThreeVector NLO[3];
+   _NLO_shapes(p1,p2,NLO);
+
+   return _cs*F12*(p1+p2)+_dot_product(_c,NLO,3)+_dot_product(_t,NLO,3)-_tau(p2);
+}
+
+ThreeVector EFTkernels::_tau(const ThreeVector& p1, const ThreeVector& p2, const ThreeVector& p3, double F123, double F23, double F12, double G23, double G12)
+{
+   ThreeVector NLO1_23[3], NLO12_3[3], NNLO[6];
+   _NLO_shapes(p1,p2+p3,NLO1_23);
+   _NLO_shapes(p1+p2,p3,NLO12_3);
+   _NNLO_shapes(p1,p2,p3,NNLO);
+
+   return _cs*F123*(p1+p2+p3)+_dot_product(_c,NLO1_23,3)*F23+_dot_product(_c,NLO12_3,3)*F12+_dot_product(_t,NLO1_23,3)*G23+_dot_product(_t,NLO12_3,3)*G12+_dot_product(_d,NNLO,6)-_tau(p2,p3,F23)-F12*_tau(p3);
 }
    
 //------------------------------------------------------------------------------
 //vorticity
-ThreeVector EFTkernels::_omega(const std::vector<ThreeVector>& p)
+ThreeVector EFTkernels::_omega(const ThreeVector& p1, const ThreeVector& p2, double F12)
 {
-   int n = p.size();
-   ThreeVector omega(0.,0.,0.);
-   
-   //Handle trivial cases
-   if (n == 0 || n == 1) { return omega; }
-   if (n > 2) { std::cout<<"Vorticity is not available at the order specified"<<std::endl; return omega; }
-   
-   if (n == 2) { omega = 2. / 9 * crossProduct(p[0]+p[1],_tau(p)); }
-   
-   return omega;
+   return 2. / 9 * crossProduct(p1+p2,_tau(p1,p2,F12));
 }
 
 //------------------------------------------------------------------------------
 //kernels
-double EFTkernels::Fn(const std::vector<ThreeVector>& p)
+void EFTkernels::set_coefficients(const EFTcoefficients& coefficients)
+{
+   _coefficients = coefficients;
+   _cs = coefficients[EFTcoefficients::cs];
+   _c[0] = coefficients[EFTcoefficients::c1];
+   _c[1] = coefficients[EFTcoefficients::c2];
+   _c[2] = coefficients[EFTcoefficients::c3];
+   _t[0] = 0.;
+   _t[1] = coefficients[EFTcoefficients::t2];
+   _t[2] = coefficients[EFTcoefficients::t3];
+   _d[0] = coefficients[EFTcoefficients::d1];
+   _d[1] = coefficients[EFTcoefficients::d2];
+   _d[2] = coefficients[EFTcoefficients::d3];
+   _d[3] = coefficients[EFTcoefficients::d4];
+   _d[4] = coefficients[EFTcoefficients::d5];
+   _d[5] = coefficients[EFTcoefficients::d6];
+}
+
+void EFTkernels::_FnGn(const ThreeVector* p, int n, double& Fnval, double& Gnval)
 {
-    int n = p.size();
-    double Fnval=0;
+    Fnval=0;
+    Gnval=0;
 
     //Handle trivial cases
-    if (n == 0) { return Fnval; }
-    if (n > 3) { std::cout<<"There is no EFT kernel available at the order specified"<<std::endl; return Fnval; }
+    if (n == 0) { return; }
+    if (n > 3) { std::cout<<"There is no EFT kernel available at the order specified"<<std::endl; return; }
 
-    if (n==1) { Fnval = cF_E(1) * (p[0]*_tau(p)) ;}
+    if (n==1) {
+       ThreeVector tau = _tau(p[0]);
+       Fnval = cF_E(1) * (p[0]*tau);
+       Gnval = cG_E(1) * (p[0]*tau);
+    }
 
     if (n==2) {
-       
-       std::vector<ThreeVector> P1={p[0]};
-       std::vector<ThreeVector> P2={p[1]};
-       
-       Fnval = cF_C(2) * alpha(p[0],p[1]) * (Gn_sym(P1) + Fn_sym(P2)) - cF_E(2) * beta(p[0],p[1]) * (Gn_sym(P1) + Gn_sym(P2)) + cF_E(2) * (p[0]+p[1])*_tau(p);
+       //EFT kernels of the single momenta
+       double F1, G1, F2, G2;
+       _FnGn_sym(p, 1, F1, G1);
+       _FnGn_sym(p+1, 1, F2, G2);
+
+       ThreeVector tau = _tau(p[0],p[1],_sptkernels.Fn_sym({p[0],p[1]}));
+       double alphaval = alpha(p[0],p[1]);
+       double betaval = beta(p[0],p[1]);
+
+       Fnval = cF_C(2) * alphaval * (G1 + F2) - cF_E(2) * betaval * (G1 + G2) + cF_E(2) * (p[0]+p[1])*tau;
+       Gnval = cG_C(2) * alphaval * (G1 + F2) - cG_E(2) * betaval * (G1 + G2) + cG_E(2) * (p[0]+p[1])*tau;
     }
 
     if (n==3) {
-       
-       std::vector<ThreeVector> P1={p[0]};
-       std::vector<ThreeVector> P23={p[1],p[2]};
-       std::vector<ThreeVector> P12={p[0],p[1]};
-       std::vector<ThreeVector> P3={p[2]};
+       //SPT kernels of all the subsets needed, from a single recursion
+       std::vector<double> sptF, sptG;
+       _sptkernels.sym_subsets(std::vector<ThreeVector> {p[0],p[1],p[2]}, {{0,1,2},{1,2},{0,1}}, sptF, sptG);
+       double sF123 = sptF[0], sF23 = sptF[1], sF12 = sptF[2];
+       double sG23 = sptG[1], sG12 = sptG[2];
+
+       //EFT kernels of the subsets
+       double F1, G1, F23, G23, F12, G12, F3, G3;
+       _FnGn_sym(p, 1, F1, G1);
+       _FnGn_sym(p+1, 2, F23, G23);
+       _FnGn_sym(p, 2, F12, G12);
+       _FnGn_sym(p+2, 1, F3, G3);
 
-       Fnval = cF_C(3) * alpha(p[0],p[1]+p[2]) * (Gn_sym(P1)*_sptkernels.Fn_sym(P23) + Fn_sym(P23)) + cF_C(3) * alpha(p[0]+p[1],p[2]) * (Fn_sym(P3)*_sptkernels.Gn_sym(P12) + Gn_sym(P12)) - cF_E(3) * beta(p[0],p[1]+p[2]) * (Gn_sym(P1)*_sptkernels.Gn_sym(P23) + Gn_sym(P23)) - cF_E(3) * beta(p[0]+p[1],p[2]) * (Gn_sym(P3)*_sptkernels.Gn_sym(P12) + Gn_sym(P12)) + cF_E(3) * (p[0]+p[1]+p[2])*_tau(p) + cF_C(3) * alphaOmega(p[0]+p[1],p[2]) * _omega(P12) + cF_E(3) * betaOmega(p[0]+p[1],p[2]) * _omega(P12);
+       ThreeVector tau = _tau(p[0],p[1],p[2],sF123,sF23,sF12,sG23,sG12);
+       ThreeVector omega = _omega(p[0],p[1],sF12);
+       //alpha and beta of the splits (1,23) and (12,3), in lanes 0 and 1 of a batch
+       static_assert(kBatchWidth >= 2, "the splits need two lanes of a batch");
+       ThreeVectorBatch pL, pR;
+       pL.set(0, p[0]);
+       pR.set(0, p[1]+p[2]);
+       pL.set(1, p[0]+p[1]);
+       pR.set(1, p[2]);
+       DoubleBatch alphas = alpha(pL,pR);
+       DoubleBatch betas = beta(pL,pR);
+       double alpha1_23 = alphas[0];
+       double alpha12_3 = alphas[1];
+       double beta1_23 = betas[0];
+       double beta12_3 = betas[1];
+       ThreeVector alphaOmega12_3 = alphaOmega(p[0]+p[1],p[2]);
+       ThreeVector betaOmega12_3 = betaOmega(p[0]+p[1],p[2]);
+
+       Fnval = cF_C(3) * alpha1_23 * (G1*sF23 + F23) + cF_C(3) * alpha12_3 * (F3*sG12 + G12) - cF_E(3) * beta1_23 * (G1*sG23 + G23) - cF_E(3) * beta12_3 * (G3*sG12 + G12) + cF_E(3) * (p[0]+p[1]+p[2])*tau + cF_C(3) * alphaOmega12_3 * omega + cF_E(3) * betaOmega12_3 * omega;
+       Gnval = cG_C(3) * alpha1_23 * (G1*sF23 + F23) + cG_C(3) * alpha12_3 * (F3*sG12 + G12) - cG_E(3) * beta1_23 * (G1*sG23 + G23) - cG_E(3) * beta12_3 * (G3*sG12 + G12) + cG_E(3) * (p[0]+p[1]+p[2])*tau + cG_C(3) * alphaOmega12_3 * omega + cG_E(3) * betaOmega12_3 * omega;
     }
-       
-    return Fnval;
+}
+
+void EFTkernels::_FnGn_sym(const ThreeVector* p, int n, double& Fnval, double& Gnval)
+{
+   Fnval = 0;
+   Gnval = 0;
+   if (n > 3) { std::cout<<"There is no EFT kernel available at the order specified"<<std::endl; return; }
+   int nperm = 0; // count the permutations
+   // use the next_permutation algorithm together with the comparison operator
+   // in ThreeVector to generate permutations
+   ThreeVector pperm[3];
+   std::copy(p, p+n, pperm);
+   std::sort(pperm, pperm+n);
+   do {
+      nperm++;
+      double F, G;
+      _FnGn(pperm, n, F, G);
+      Fnval += F;
+      Gnval += G;
+   } while (std::next_permutation(pperm, pperm+n));
+
+   Fnval /= nperm;
+   Gnval /= nperm;
+}
+
+//------------------------------------------------------------------------------
+double EFTkernels::Fn(const std::vector<ThreeVector>& p)
+{
+   double Fnval, Gnval;
+   _FnGn(p.data(), p.size(), Fnval, Gnval);
+   return Fnval;
 }
    
 //------------------------------------------------------------------------------
 double EFTkernels::Gn(const std::vector<ThreeVector>& p)
 {
-   int n = p.size();
-   double Gnval=0;
-      
-   //Handle trivial cases
-   if (n == 0) { return Gnval; }
-   if (n > 3) { std::cout<<"There is no EFT kernel available at the order specified"<<std::endl; return Gnval; }
-   
-   if (n==1) { Gnval = cG_E(1) * (p[0]*_tau(p)) ;}
-      
-   if (n==2) {
-         
-      std::vector<ThreeVector> P1={p[0]};
-      std::vector<ThreeVector> P2={p[1]};
-         
-      Gnval = cG_C(2) * alpha(p[0],p[1]) * (Gn_sym(P1) + Fn_sym(P2)) - cG_E(2) * beta(p[0],p[1]) * (Gn_sym(P1) + Gn_sym(P2)) + cG_E(2) * (p[0]+p[1])*_tau(p);
-   }
-      
-   if (n==3) {
-         
-      std::vector<ThreeVector> P1={p[0]};
-      std::vector<ThreeVector> P23={p[1],p[2]};
-      std::vector<ThreeVector> P12={p[0],p[1]};
-      std::vector<ThreeVector> P3={p[2]};
-         
-      Gnval = cG_C(3) * alpha(p[0],p[1]+p[2]) * (Gn_sym(P1)*_sptkernels.Fn_sym(P23) + Fn_sym(P23)) + cG_C(3) * alpha(p[0]+p[1],p[2]) * (Fn_sym(P3)*_sptkernels.Gn_sym(P12) + Gn_sym(P12)) - cG_E(3) * beta(p[0],p[1]+p[2]) * (Gn_sym(P1)*_sptkernels.Gn_sym(P23) + Gn_sym(P23)) - cG_E(3) * beta(p[0]+p[1],p[2]) * (Gn_sym(P3)*_sptkernels.Gn_sym(P12) + Gn_sym(P12)) + cG_E(3) * (p[0]+p[1]+p[2])*_tau(p) + cG_C(3) * alphaOmega(p[0]+p[1],p[2]) * _omega(P12) + cG_E(3) * betaOmega(p[0]+p[1],p[2]) * _omega(P12);
-   }
-      
+   double Fnval, Gnval;
+   _FnGn(p.data(), p.size(), Fnval, Gnval);
    return Gnval;
 }
    
 //------------------------------------------------------------------------------
 double EFTkernels::Fn_sym(const std::vector<ThreeVector>& p)
 {
-   double value = 0;
-   int nperm = 0; // count the permutations
-   // use the next_permutation algorithm together with the comparison operator
-   // in ThreeVector to generate permutations
-   std::vector<ThreeVector> pperm = p;
-   std::sort(pperm.begin(),pperm.end());
-   do {
-      nperm++;
-      value += Fn(pperm);
-   } while (std::next_permutation(pperm.begin(), pperm.end()));
-
-   return value / nperm;
+   double Fnval, Gnval;
+   _FnGn_sym(p.data(), p.size(), Fnval, Gnval);
+   return Fnval;
 }
 
 //------------------------------------------------------------------------------
 double EFTkernels::Gn_sym(const std::vector<ThreeVector>& p)
 {
-   double value = 0;
-   int nperm = 0; // count the permutations
-   // use the next_permutation algorithm together with the comparison operator
-   // in ThreeVector to generate permutations
-   std::vector<ThreeVector> pperm = p;
-   std::sort(pperm.begin(),pperm.end());
-   do {
-      nperm++;
-      value += Gn(pperm);
-   } while (std::next_permutation(pperm.begin(), pperm.end()));
-
-   return value / nperm;
+   double Fnval, Gnval;
+   _FnGn_sym(p.data(), p.size(), Fnval, Gnval);
+   return Gnval;
 }
    
 //------------------------------------------------------------------------------
 //Helper function
    
-ThreeVector EFTkernels::_dot_product(std::vector<double> a, std::vector<ThreeVector> b)
+ThreeVector EFTkernels::_dot_product(const double* a, const ThreeVector* b, int n)
 {
    ThreeVector dot(0.,0.,0.);
-   if(a.size() == b.size()){for(unsigned int i=0; i<a.size(); i++){dot+=a[i]*b[i];}}
-   else { throw std::invalid_argument( "Received invalid argument in dot product. Size of vectors does not match" );}
+   for(int i=0; i<n; i++){dot+=a[i]*b[i];}
       
    return dot;
 }
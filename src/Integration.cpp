@@ -16,25 +16,141 @@
 //    Implementation of class Integration
 //------------------------------------------------------------------------------
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <random>
 #include <sstream>
+#include <stdexcept>
+#include <unistd.h>
 
 #include "Integration.hpp"
 
 namespace fnfast {
 
 //------------------------------------------------------------------------------
-IntegralResult VEGASintegrator::integrate(integrand_t integrand, void * userdata)
+std::unique_ptr<IntegratorBase> IntegratorBase::create(IntegrationMethod method, int numdim, int seed, double err, int neval, const std::string& state)
+{
+   std::unique_ptr<IntegratorBase> integrator;
+   if (method == IntegrationMethod::kVEGAS) {
+      integrator.reset(new VEGASintegrator(numdim, err, neval, 1000, 1000, 1000, seed));
+   } else {
+      integrator.reset(new QMCintegrator(numdim, method, seed, err, neval));
+   }
+   integrator->statefile = state;
+   return integrator;
+}
+
+//------------------------------------------------------------------------------
+IntegralResult combine(const std::vector<IntegralResult>& estimates)
+{
+   if (estimates.empty()) { return IntegralResult(0, 0, 0); }
+
+   // exact estimates
+   double exact = 0;
+   int nexact = 0;
+   for (auto& estimate : estimates) {
+      if (estimate.error == 0) {
+         exact += estimate.result;
+         nexact++;
+      }
+   }
+   if (nexact > 0) { return IntegralResult(exact / nexact, 0, 0); }
+   if (estimates.size() == 1) { return estimates[0]; }
+
+   // inverse-variance weighted mean
+   double sumw = 0, sumwx = 0;
+   for (auto& estimate : estimates) {
+      double w = 1. / (estimate.error * estimate.error);
+      sumw += w;
+      sumwx += w * estimate.result;
+   }
+   double mean = sumwx / sumw;
+
+   // chi^2 of the estimates about the mean, its probability with n - 1 degrees of freedom
+   double chi2 = 0;
+   for (auto& estimate : estimates) {
+      chi2 += std::pow((estimate.result - mean) / estimate.error, 2);
+   }
+   double dof = estimates.size() - 1;
+   double s = 2. / (9. * dof);
+   double z = (std::cbrt(chi2 / dof) - (1 - s)) / std::sqrt(s);
+   double prob = 0.5 * std::erfc(-z / std::sqrt(2.));
+
+   return IntegralResult(mean, 1. / std::sqrt(sumw), prob);
+}
+
+//------------------------------------------------------------------------------
+IntegralResult IntegratorBase::integrate(integrand_t integrand, void * userdata)
+{
+   return integrate(integrand, userdata, 1)[0];
+}
+
+//------------------------------------------------------------------------------
+// name of a temporary state file, unique to the process and the call
+static std::string temporary_statefile()
+{
+   static std::atomic<long> count(0);
+   const char* dir = std::getenv("TMPDIR");
+   std::ostringstream name;
+   name << (dir ? dir : "/tmp") << "/fnfast-state-" << getpid() << "-" << count++;
+   return name.str();
+}
+
+//------------------------------------------------------------------------------
+IntegralResult IntegratorBase::integrate(integrand_t integrand, void * userdata, const ErrorTarget& target)
+{
+   double epsrel0 = epsrel;
+   double epsabs0 = epsabs;
+
+   IntegralResult result(0, 0, 0);
+   if (target.reference == 0) {
+      // the target is the native criterion
+      epsrel = target.relative;
+      epsabs = target.absolute;
+      result = integrate(integrand, userdata);
+   } else {
+      // absolute targets, starting from the reference alone; each pass
+      // continues the samples of the previous one from the retained state
+      std::string statefile0 = statefile;
+      if (statefile.empty()) { statefile = temporary_statefile(); }
+      retain = true;
+      epsrel = 0;
+      double goal = target.error(0);
+      for (int pass = 0; pass < 3; pass++) {
+         epsabs = goal;
+         result = integrate(integrand, userdata);
+         // converged to the new target, or maxeval exhausted before the previous one
+         goal = target.error(result.result);
+         if (result.error <= goal || result.error > epsabs) { break; }
+      }
+      retain = false;
+      std::remove(statefile.c_str());
+      statefile = statefile0;
+   }
+
+   epsrel = epsrel0;
+   epsabs = epsabs0;
+   return result;
+}
+
+//------------------------------------------------------------------------------
+IntegralResults VEGASintegrator::integrate(integrand_t integrand, void * userdata, int ncomp)
 {
    // VEGAS integration parameters
 
    // PARAMETER: phase space dimensionality set by ndim
-   // number of computations
-   const int ncomp = 1; // only 1 computation
+   // PARAMETER: number of computations set by ncomp
    // number of points sent to the integrand per invocation
    const int nvec = 1; // no vectorization
    // PARAMETER: relative precision set by epsrel
-   const double epsabs = 0;
+   // PARAMETER: absolute precision set by epsabs
    // min, max number of points
    const int mineval = 0;
    // PARAMETER: maximum number of integrand calls set by maxeval
@@ -44,12 +160,10 @@ IntegralResult VEGASintegrator::integrate(integrand_t integrand, void * userdata
    // grid number
    // 1-10 saves the grid for another integration
    const int gridnum = 0;
-   // file for the state of the integration
-   const char *statefile = NULL;
+   // file for the state of the integration, set by statefile
    // spin
    void* spin = NULL;
-   // random number seed
-   const int vegasseed = 37;
+   // PARAMETER: random number seed set by seed
    // flags:
    // bits 0&1: verbosity level
    // bit 2: whether or not to use only last sample (0 for all samps, 1 for last only)
@@ -59,25 +173,300 @@ IntegralResult VEGASintegrator::integrate(integrand_t integrand, void * userdata
    //    seed = 0: Sobol (quasi-random) used, ignores bits 8-31 of flags
    //    seed > 0, bits 8-31 of flags = 0: Mersenne Twister
    //    seed > 0, bits 8-31 of flags > 0: Ranlux
-   // current flag setting: 1038 = 10000001110
+   // current flag setting: 1038 = 10000001110, with bit 4 if retain
    int flags = 1038;
+   if (retain) { flags |= 16; }
    // number of regions, evaluations, fail code
    int neval, fail;
 
    // containers for output
-   double integral[ncomp], error[ncomp], prob[ncomp];
+   IntegralResults results(ncomp);
 
-   // run VEGAS
+   // run VEGAS, in this process only if serial
+   if (serial) { cubacores(0, 0); }
    Vegas(ndim, ncomp, integrand, userdata, nvec,
-       epsrel, epsabs, flags, vegasseed,
+       epsrel, epsabs, flags, seed,
        mineval, maxeval, nstart, nincrease, nbatch,
-       gridnum, statefile, spin,
-       &neval, &fail, integral, error, prob);
+       gridnum, statefile.empty() ? NULL : statefile.c_str(), spin,
+       &neval, &fail, results.result.data(), results.error.data(), results.prob.data());
+   if (serial) {
+      const char* cores = std::getenv("CUBACORES");
+      const char* pcores = std::getenv("CUBACORESMAX");
+      cubacores(cores ? std::atoi(cores) : -sysconf(_SC_NPROCESSORS_ONLN), pcores ? std::atoi(pcores) : 10000);
+   }
 
-   // save the results in a container
-   IntegralResult result(integral[0], error[0], prob[0]);
+   return results;
+}
 
-   return result;
+//------------------------------------------------------------------------------
+std::string VEGASintegrator::settings() const
+{
+   std::ostringstream out;
+   out << std::setprecision(17) << "VEGAS ndim=" << ndim << " epsrel=" << epsrel << " epsabs=" << epsabs << " maxeval=" << maxeval
+       << " nstart=" << nstart << " nincrease=" << nincrease << " nbatch=" << nbatch << " seed=" << seed;
+   return out.str();
+}
+
+//------------------------------------------------------------------------------
+DiagramIntegrals IntegratorBase::integrate_diagrams(integrand_t integrand, void * userdata, int* diagram, const std::vector<std::string>& names, GridMode mode)
+{
+   DiagramIntegrals integrals;
+   integrals.names = names;
+   int ndiagrams = names.size();
+
+   if (mode == GridMode::kShared) {
+      // one run, the total in component 0 and the diagrams after it
+      *diagram = -1;
+      IntegralResults results = integrate(integrand, userdata, ndiagrams + 1);
+      integrals.total = results[0];
+      for (int i = 1; i <= ndiagrams; i++) {
+         integrals.diagrams.push_back(results[i]);
+      }
+   } else {
+      // one run per diagram, independent samples, each with its own checkpoint
+      std::string state = statefile;
+      double error2 = 0;
+      for (int i = 0; i < ndiagrams; i++) {
+         *diagram = i;
+         if (!state.empty()) { statefile = state + "." + names[i]; }
+         IntegralResult result = integrate(integrand, userdata);
+         integrals.diagrams.push_back(result);
+         integrals.total.result += result.result;
+         error2 += result.error * result.error;
+         integrals.total.prob = std::max(integrals.total.prob, result.prob);
+      }
+      integrals.total.error = sqrt(error2);
+      *diagram = -1;
+      statefile = state;
+   }
+
+   return integrals;
+}
+
+//------------------------------------------------------------------------------
+// QMC point sets
+//------------------------------------------------------------------------------
+
+// generating vector of the lattice rule, extensible in n = 2^m: a component by
+// component construction for n = 2^8 ... 2^20 jointly, minimizing the shift
+// averaged worst case error (sum over m of 4^m e_m^2) in the Korobov space
+// with smoothness 2 and product weights 1/j^2, over 384 random candidates per
+// component
+static const uint32_t kLatticeVector[QMCintegrator::kMaxDim] = {
+   1, 186687, 477019, 154189, 227429, 64175, 144323, 473829, 169151, 318971, 86603, 425117
+};
+
+// Sobol primitive polynomials (degree s, coefficients a) and initial direction
+// numbers m_k of dimensions 2 ... 12, from Joe and Kuo (new-joe-kuo-6.21201)
+static const int kSobolDegree[QMCintegrator::kMaxDim - 1] = {1, 2, 3, 3, 4, 4, 5, 5, 5, 5, 5};
+static const uint32_t kSobolCoefficients[QMCintegrator::kMaxDim - 1] = {0, 1, 1, 2, 1, 4, 2, 4, 7, 11, 13};
+static const uint32_t kSobolInitial[QMCintegrator::kMaxDim - 1][5] = {
+   {1}, {1, 3}, {1, 3, 1}, {1, 1, 1}, {1, 1, 3, 3}, {1, 3, 5, 13},
+   {1, 1, 5, 5, 17}, {1, 1, 5, 5, 5}, {1, 1, 7, 11, 19}, {1, 1, 5, 1, 1}, {1, 1, 1, 3, 11}
+};
+
+// direction numbers v[k], k = 0..31, of Sobol dimension j (0 based), bit 31 the most significant
+static void sobol_directions(int j, uint32_t v[32])
+{
+   if (j == 0) {
+      for (int k = 0; k < 32; k++) { v[k] = 1u << (31 - k); }
+      return;
+   }
+   int s = kSobolDegree[j-1];
+   uint32_t a = kSobolCoefficients[j-1];
+   for (int k = 0; k < s; k++) { v[k] = kSobolInitial[j-1][k] << (31 - k); }
+   for (int k = s; k < 32; k++) {
+      v[k] = v[k-s] ^ (v[k-s] >> s);
+      for (int l = 1; l < s; l++) {
+         if ((a >> (s - 1 - l)) & 1) { v[k] ^= v[k-l]; }
+      }
+   }
+}
+
+// bit reversal of a 32 bit integer, the radical inverse in base 2 times 2^32
+static uint32_t reverse_bits(uint32_t i)
+{
+   i = ((i >> 1) & 0x55555555u) | ((i & 0x55555555u) << 1);
+   i = ((i >> 2) & 0x33333333u) | ((i & 0x33333333u) << 2);
+   i = ((i >> 4) & 0x0F0F0F0Fu) | ((i & 0x0F0F0F0Fu) << 4);
+   i = ((i >> 8) & 0x00FF00FFu) | ((i & 0x00FF00FFu) << 8);
+   return (i >> 16) | (i << 16);
+}
+
+//------------------------------------------------------------------------------
+QMCintegrator::QMCintegrator(int numdim, IntegrationMethod qmcrule, int rngseed, double err, int neval, int numstart, int numshifts)
+: IntegratorBase(numdim, err, neval), rule(qmcrule), seed(rngseed), nstart(numstart), nshifts(numshifts)
+{
+   if (ndim < 1 || ndim > kMaxDim) {
+      throw std::invalid_argument("QMCintegrator: dimension out of range");
+   }
+   if (rule == IntegrationMethod::kVEGAS) {
+      throw std::invalid_argument("QMCintegrator: rule must be kLattice or kSobol");
+   }
+   if (nshifts < 2) {
+      throw std::invalid_argument("QMCintegrator: at least two randomizations are needed for an error");
+   }
+}
+
+//------------------------------------------------------------------------------
+std::string QMCintegrator::settings() const
+{
+   std::ostringstream out;
+   out << std::setprecision(17) << (rule == IntegrationMethod::kLattice ? "lattice" : "Sobol") << " ndim=" << ndim
+       << " epsrel=" << epsrel << " epsabs=" << epsabs << " maxeval=" << maxeval
+       << " seed=" << seed << " nstart=" << nstart << " nshifts=" << nshifts;
+   return out.str();
+}
+
+//------------------------------------------------------------------------------
+void QMCintegrator::sum(integrand_t integrand, void * userdata, int ncomp, int shift, long begin, long end, double* sums) const
+{
+   // the randomization of this shift
+   std::seed_seq seq {seed, shift};
+   std::mt19937_64 rng(seq);
+   uint32_t random[kMaxDim];
+   for (int j = 0; j < ndim; j++) { random[j] = static_cast<uint32_t>(rng() >> 32); }
+
+   // scrambled Sobol directions: y = L v with L random lower triangular (bits
+   // from the most significant) with unit diagonal, then a digital shift
+   uint32_t directions[kMaxDim][32];
+   if (rule == IntegrationMethod::kSobol) {
+      for (int j = 0; j < ndim; j++) {
+         uint32_t rows[32];
+         for (int r = 0; r < 32; r++) {
+            uint32_t above = (r == 0) ? 0 : ~0u << (32 - r);
+            rows[r] = (1u << (31 - r)) | (static_cast<uint32_t>(rng() >> 32) & above);
+         }
+         uint32_t v[32];
+         sobol_directions(j, v);
+         for (int k = 0; k < 32; k++) {
+            uint32_t y = 0;
+            for (int r = 0; r < 32; r++) {
+               y |= static_cast<uint32_t>(__builtin_parity(rows[r] & v[k])) << (31 - r);
+            }
+            directions[j][k] = y;
+         }
+      }
+   }
+
+   const double scale = 1. / 4294967296.;
+   std::vector<double> x(ndim), f(ncomp);
+   for (long i = begin; i < end; i++) {
+      if (rule == IntegrationMethod::kLattice) {
+         uint32_t phi = reverse_bits(static_cast<uint32_t>(i));
+         for (int j = 0; j < ndim; j++) {
+            // {phi_2(i) z_j + Delta_j} exactly in 32 bit arithmetic, then the tent transform
+            double u = (static_cast<uint32_t>(phi * kLatticeVector[j] + random[j]) + 0.5) * scale;
+            x[j] = 1 - std::abs(2 * u - 1);
+         }
+      } else {
+         for (int j = 0; j < ndim; j++) {
+            uint32_t y = random[j];
+            for (int k = 0; k < 32; k++) {
+               if ((i >> k) & 1) { y ^= directions[j][k]; }
+            }
+            x[j] = (y + 0.5) * scale;
+         }
+      }
+
+      integrand(&ndim, x.data(), &ncomp, f.data(), userdata);
+      for (int c = 0; c < ncomp; c++) { sums[c] += f[c]; }
+   }
+}
+
+//------------------------------------------------------------------------------
+IntegralResults QMCintegrator::integrate(integrand_t integrand, void * userdata, int ncomp)
+{
+   long n = 1;
+   while (n < nstart) { n *= 2; }
+
+   // integrand sums of each randomization and the points they reached, extended as n doubles
+   std::vector<double> sums(nshifts * ncomp, 0);
+   std::vector<long> reached(nshifts, 0);
+   if (!statefile.empty()) { load_state(ncomp, n, reached, sums); }
+   IntegralResults results(ncomp);
+   while (true) {
+      for (int shift = 0; shift < nshifts; shift++) {
+         if (reached[shift] >= n) { continue; }
+         sum(integrand, userdata, ncomp, shift, reached[shift], n, &sums[shift * ncomp]);
+         reached[shift] = n;
+         if (!statefile.empty()) { save_state(ncomp, n, reached, sums); }
+      }
+
+      // mean and standard error over the randomizations
+      bool converged = true;
+      for (int c = 0; c < ncomp; c++) {
+         double mean = 0;
+         for (int shift = 0; shift < nshifts; shift++) { mean += sums[shift * ncomp + c] / n; }
+         mean /= nshifts;
+         double var = 0;
+         for (int shift = 0; shift < nshifts; shift++) {
+            double d = sums[shift * ncomp + c] / n - mean;
+            var += d * d;
+         }
+         var /= (nshifts - 1);
+         results.result[c] = mean;
+         results.error[c] = sqrt(var / nshifts);
+         if (results.error[c] > std::max(epsabs, epsrel * std::abs(mean))) { converged = false; }
+      }
+
+      if (converged || 2 * n * nshifts > maxeval) {
+         results.prob.assign(ncomp, converged ? 0 : 1);
+         if (!statefile.empty() && !retain) { std::remove(statefile.c_str()); }
+         return results;
+      }
+      n *= 2;
+   }
+}
+
+//------------------------------------------------------------------------------
+void QMCintegrator::save_state(int ncomp, long n, const std::vector<long>& reached, const std::vector<double>& sums) const
+{
+   // write a new file and rename it over the old one, so that an interruption
+   // leaves either the old or the new state
+   std::string tmpfile = statefile + ".tmp";
+   {
+      std::ofstream file(tmpfile, std::ios::trunc);
+      file << std::setprecision(17);
+      file << "QMC " << (rule == IntegrationMethod::kLattice ? "lattice" : "Sobol") << " " << ndim << " " << seed << " "
+           << nstart << " " << nshifts << " " << ncomp << std::endl;
+      file << n << std::endl;
+      for (int shift = 0; shift < nshifts; shift++) {
+         file << reached[shift];
+         for (int c = 0; c < ncomp; c++) { file << " " << sums[shift * ncomp + c]; }
+         file << std::endl;
+      }
+      if (!file.good()) { return; }
+   }
+   std::rename(tmpfile.c_str(), statefile.c_str());
+}
+
+//------------------------------------------------------------------------------
+bool QMCintegrator::load_state(int ncomp, long& n, std::vector<long>& reached, std::vector<double>& sums) const
+{
+   std::ifstream file(statefile);
+   std::string tag, filerule;
+   int filendim, fileseed, filenstart, filenshifts, filencomp;
+   if (!(file >> tag >> filerule >> filendim >> fileseed >> filenstart >> filenshifts >> filencomp)) { return false; }
+   if (tag != "QMC" || filerule != (rule == IntegrationMethod::kLattice ? "lattice" : "Sobol") || filendim != ndim || fileseed != seed
+       || filenstart != nstart || filenshifts != nshifts || filencomp != ncomp) {
+      return false;
+   }
+
+   long filen;
+   std::vector<long> filereached(nshifts);
+   std::vector<double> filesums(nshifts * ncomp);
+   file >> filen;
+   for (int shift = 0; shift < nshifts; shift++) {
+      file >> filereached[shift];
+      for (int c = 0; c < ncomp; c++) { file >> filesums[shift * ncomp + c]; }
+   }
+   if (file.fail()) { return false; }
+
+   n = filen;
+   reached = filereached;
+   sums = filesums;
+   return true;
 }
 
 } // namespace fnfast
@@ -0,0 +1,199 @@
+//------------------------------------------------------------------------------
+/// \file KernelDAG.cpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Implementation of class KernelDAG
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+
+#include "KernelDAG.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+int KernelDAG::add_momentum(const Combination& p)
+{
+   auto found = _momentumindex.find(p);
+   if (found != _momentumindex.end()) { return found->second; }
+   int node = _momenta.size();
+   _momenta.push_back(p);
+   _momentumindex[p] = node;
+   return node;
+}
+
+//------------------------------------------------------------------------------
+int KernelDAG::add_kernel(KernelType ktype, const std::vector<Combination>& p)
+{
+   _ncalls++;
+   // the kernels are symmetrized, so the order of the momenta is irrelevant:
+   // the sorted list of momentum nodes is the canonical form of the call
+   std::vector<int> momenta;
+   momenta.reserve(p.size());
+   for (auto& pi : p) {
+      momenta.push_back(add_momentum(pi));
+   }
+   std::sort(momenta.begin(), momenta.end());
+
+   std::pair<KernelType, std::vector<int> > key(ktype, momenta);
+   auto found = _kernelindex.find(key);
+   if (found != _kernelindex.end()) { return found->second; }
+   int node = _kerneltypes.size();
+   _kerneltypes.push_back(ktype);
+   _kernelmomenta.push_back(momenta);
+   _kernelindex[key] = node;
+   _groups.push_back(std::vector<int>());
+   _grouproot.push_back(-1);
+   _groupposition.push_back(0);
+   _groupoffset.push_back(0);
+   return node;
+}
+
+//------------------------------------------------------------------------------
+void KernelDAG::group()
+{
+   /*
+    * Visit the kernel nodes from the most to the least momenta.
+    * A node whose momentum nodes are a sub-multiset of those of an
+    * earlier root joins that root's group, otherwise it becomes a root.
+    * Only the root triggers the group evaluation, so a small node needed
+    * without its root is still evaluated on its own.
+    */
+   size_t nnodes = _kerneltypes.size();
+   _groups.assign(nnodes, std::vector<int>());
+   _groupsubsets.assign(nnodes, std::vector<std::vector<int> >());
+   std::vector<int> order(nnodes);
+   for (size_t i = 0; i < nnodes; i++) { order[i] = i; }
+   std::stable_sort(order.begin(), order.end(), [this](int a, int b) { return _kernelmomenta[a].size() > _kernelmomenta[b].size(); });
+
+   std::vector<int> roots;
+   for (auto node : order) {
+      const std::vector<int>& momenta = _kernelmomenta[node];
+      bool grouped = false;
+      for (auto root : roots) {
+         const std::vector<int>& rootmomenta = _kernelmomenta[root];
+         if (rootmomenta.size() <= momenta.size()) { continue; }
+         // both lists are sorted: match the momenta in order
+         std::vector<int> positions;
+         size_t j = 0;
+         for (size_t i = 0; i < rootmomenta.size() && j < momenta.size(); i++) {
+            if (rootmomenta[i] == momenta[j]) {
+               positions.push_back(i);
+               j++;
+            }
+         }
+         if (j == momenta.size()) {
+            _groups[root].push_back(node);
+            _groupsubsets[root].push_back(positions);
+            grouped = true;
+            break;
+         }
+      }
+      if (!grouped) {
+         roots.push_back(node);
+         // the root itself is the first entry of its group
+         std::vector<int> positions(momenta.size());
+         for (size_t i = 0; i < momenta.size(); i++) { positions[i] = i; }
+         _groups[node].push_back(node);
+         _groupsubsets[node].push_back(positions);
+      }
+   }
+   // a group with only the root does not need the group evaluation
+   _grouproot.assign(nnodes, -1);
+   _groupposition.assign(nnodes, 0);
+   _groupoffset.assign(nnodes, 0);
+   _ngroupvalues = 0;
+   for (auto root : roots) {
+      if (_groups[root].size() == 1) {
+         _groups[root].clear();
+         _groupsubsets[root].clear();
+         continue;
+      }
+      _groupoffset[root] = _ngroupvalues;
+      for (size_t i = 0; i < _groups[root].size(); i++) {
+         _grouproot[_groups[root][i]] = root;
+         _groupposition[_groups[root][i]] = i;
+      }
+      _ngroupvalues += _groups[root].size();
+   }
+}
+
+//------------------------------------------------------------------------------
+KernelDAG::Combination KernelDAG::combination(const Propagator& prop, const int* indices, int qsign, const Combination& pole)
+{
+   Combination p;
+   p.fill(0);
+   int qslot = MomentumView::slot(Momentum::q);
+   for (auto& slot : prop.slots()) {
+      if (slot.first == qslot) {
+         // route the loop momentum
+         p[qslot] += slot.second * qsign;
+         for (int i = 0; i < MomentumView::kNumSlots; i++) {
+            p[i] += slot.second * pole[i];
+         }
+      } else {
+         p[indices[slot.first]] += slot.second;
+      }
+   }
+   return p;
+}
+
+//------------------------------------------------------------------------------
+KernelDAG::Evaluation::Evaluation(const KernelDAG& dag, const ThreeVector* flatmom)
+: _dag(&dag), _momenta(dag._momenta.size()), _values(dag._kerneltypes.size(), 0), _kernels(dag._kerneltypes.size(), nullptr),
+  _powers(dag._momenta.size(), 0), _spectra(dag._momenta.size(), nullptr),
+  _groupFn(dag._ngroupvalues, 0), _groupGn(dag._ngroupvalues, 0), _groupkernels(dag._kerneltypes.size(), nullptr), _nkernelcalls(0)
+{
+   // all momentum combinations are cheap, compute them up front
+   for (size_t node = 0; node < _momenta.size(); node++) {
+      const Combination& p = dag._momenta[node];
+      for (int i = 0; i < MomentumView::kNumSlots; i++) {
+         if (p[i] == 1) { _momenta[node] += flatmom[i]; }
+         else if (p[i] == -1) { _momenta[node] -= flatmom[i]; }
+         else if (p[i] != 0) { _momenta[node] += p[i] * flatmom[i]; }
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+double KernelDAG::Evaluation::compute(int node, KernelBase* kernel)
+{
+   _nkernelcalls++;
+   _p.clear();
+   for (auto momentum : _dag->_kernelmomenta[node]) {
+      _p.push_back(_momenta[momentum]);
+   }
+   if (_dag->_kerneltypes[node] == KernelType::delta) {
+      return kernel->Fn_sym(_p);
+   } else {
+      return kernel->Gn_sym(_p);
+   }
+}
+
+//------------------------------------------------------------------------------
+void KernelDAG::Evaluation::compute_group(int root, KernelBase* kernel)
+{
+   _nkernelcalls++;
+   _p.clear();
+   for (auto momentum : _dag->_kernelmomenta[root]) {
+      _p.push_back(_momenta[momentum]);
+   }
+   kernel->sym_subsets(_p, _dag->_groupsubsets[root], _Fn, _Gn);
+   // the nodes of the group take their values when they are requested
+   std::copy(_Fn.begin(), _Fn.end(), _groupFn.begin() + _dag->_groupoffset[root]);
+   std::copy(_Gn.begin(), _Gn.end(), _groupGn.begin() + _dag->_groupoffset[root]);
+   _groupkernels[root] = kernel;
+}
+
+} // namespace fnfast
@@ -29,7 +29,7 @@
 namespace fnfast {
 
 //------------------------------------------------------------------------------
-LinearPowerSpectrumCAMB::LinearPowerSpectrumCAMB(const std::string& input_file): _input_file(input_file), _accel_ptr(NULL), _spline_ptr(NULL), _kmin(0.)
+LinearPowerSpectrumCAMB::LinearPowerSpectrumCAMB(const std::string& input_file): _input_file(input_file), _spline_ptr(NULL), _kmin(0.)
 {
     std::ifstream file;
     file.open(_input_file);
@@ -107,7 +107,6 @@ LinearPowerSpectrumCAMB::LinearPowerSpectrumCAMB(const std::string& input_file):
         std::copy(_Pvec_patches.begin(),_Pvec_patches.end(),P_vals);
 
         // Allocate interpolation pointers and initialize interpolation
-        _accel_ptr = gsl_interp_accel_alloc();
         _spline_ptr = gsl_spline_alloc (gsl_interp_cspline, npts_tot);
         gsl_spline_init(_spline_ptr, k_vals, P_vals, npts_tot);
     }
@@ -125,7 +124,8 @@ double LinearPowerSpectrumCAMB::operator()(double x)
    
    // if k<_kmin, P=0;
    if( x > _kmin && x < k0) res = exp(_c0_low) * pow(x,_c1_low);  // Patch at low k
-   if( x > k0 && x < _kvec_patches.back()) res = gsl_spline_eval(_spline_ptr, x, _accel_ptr); // Interpolated function
+   // Interpolated function, by binary search: a gsl accelerator would be written by each call
+   if( x > k0 && x < _kvec_patches.back()) res = gsl_spline_eval(_spline_ptr, x, NULL);
    if( x >= _kvec_patches.back()) res = exp(_c0_high) * pow(x,_c1_high); // Patch at high k
    
    return res;
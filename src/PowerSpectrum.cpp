@@ -24,7 +24,16 @@ namespace fnfast {
 
 //------------------------------------------------------------------------------
 /*DAN*/
-PowerSpectrum::PowerSpectrum(Order order) : _order(order), _diagrams(DiagramSet2pointSPT(_order)), _EFTdiagrams(DiagramSet2pointEFT(_EFTorder(_order))), _UVcutoff(10.) {}
+PowerSpectrum::PowerSpectrum(Order order) : _order(order), _diagrams(DiagramSet2pointSPT(_order)), _EFTdiagrams(DiagramSet2pointEFT(_EFTorder(_order))), _UVcutoff(10.), _seed(37), _method(IntegrationMethod::kVEGAS), _epsrel(1e-3), _maxeval(250000), _cache(nullptr) {}
+
+//------------------------------------------------------------------------------
+std::unique_ptr<IntegratorBase> PowerSpectrum::make_integrator(int ndim) const
+{
+   std::unique_ptr<IntegratorBase> integrator = IntegratorBase::create(_method, ndim, _seed, _epsrel, _maxeval, _statefile);
+   // the profile is recorded in the integrand, which must not run in Cuba's worker processes
+   integrator->serial = (_diagrams.profile() != nullptr);
+   return integrator;
+}
 
 //------------------------------------------------------------------------------
 double PowerSpectrum::tree(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
@@ -42,10 +51,100 @@ IntegralResult PowerSpectrum::oneLoop(double k, const LabelMap<Vertex, KernelBas
    // integration method
    LoopPhaseSpace phasespace(k, _UVcutoff, &kernels, PL, this);
 
-   // VEGAS integration via cuba
-   VEGASintegrator vegas(2);
+   // integration by the loop integration method (VEGAS via cuba by default)
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(2);
+
+   // cached result
+   std::string key;
+   IntegralResults cached;
+   if (_cache) {
+      key = ResultCache::key("PowerSpectrum::oneLoop", _order, {k}, _UVcutoff, _diagrams.qmax(), kernels, PL, *integrator);
+      if (!_diagrams.profile() && _cache->find(key, cached)) { return cached[0]; }
+   }
+
+   IntegralResult result = integrator->integrate(oneLoop_integrand, &phasespace);
+   if (_cache) { _cache->store(key, result); }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+IntegralResult PowerSpectrum::oneLoop(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, const ErrorTarget& target) const
+{
+   // integration method
+   LoopPhaseSpace phasespace(k, _UVcutoff, &kernels, PL, this);
+
+   // integration by the loop integration method to the target
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(2);
+
+   // cached result
+   std::string key;
+   IntegralResults cached;
+   if (_cache) {
+      key = ResultCache::key("PowerSpectrum::oneLoop target", _order, {k, target.absolute, target.relative, target.reference}, _UVcutoff, _diagrams.qmax(), kernels, PL, *integrator);
+      if (!_diagrams.profile() && _cache->find(key, cached)) { return cached[0]; }
+   }
+
+   IntegralResult result = integrator->integrate(oneLoop_integrand, &phasespace, target);
+   if (_cache) { _cache->store(key, result); }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+IntegralResults PowerSpectrum::oneLoop_sweep(const std::vector<double>& k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, double relative, const std::vector<double>& absolute) const
+{
+   IntegralResults results(k.size());
+   for (size_t i = 0; i < k.size(); i++) {
+      // the target is relative to the full observable, tree level plus one loop
+      ErrorTarget target(absolute.empty() ? 0 : absolute[i], relative, tree(k[i], kernels, PL));
+      IntegralResult result = oneLoop(k[i], kernels, PL, target);
+      results.result[i] = result.result;
+      results.error[i] = result.error;
+      results.prob[i] = result.prob;
+   }
+
+   return results;
+}
+
+//------------------------------------------------------------------------------
+IntegralResults PowerSpectrum::oneLoop(const std::vector<double>& k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   if (k.empty()) { return IntegralResults(); }
+
+   // integration method, the k bins share the loop momentum phase space
+   LoopPhaseSpace phasespace(k[0], _UVcutoff, &kernels, PL, this);
+   phasespace.kbins = k;
 
-   return vegas.integrate(oneLoop_integrand, &phasespace);
+   // integration by the loop integration method (VEGAS via cuba by default), a component per k bin;
+   // the integrand does not record a profile, so it may run in Cuba's worker processes
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(2);
+   integrator->serial = false;
+
+   // cached result
+   std::string key;
+   IntegralResults cached;
+   if (_cache) {
+      key = ResultCache::key("PowerSpectrum::oneLoop kbins", _order, k, _UVcutoff, _diagrams.qmax(), kernels, PL, *integrator);
+      if (_cache->find(key, cached)) { return cached; }
+   }
+
+   IntegralResults result = integrator->integrate(oneLoop_kbins_integrand, &phasespace, k.size());
+   if (_cache) { _cache->store(key, result); }
+
+   return result;
+}
+
+//------------------------------------------------------------------------------
+DiagramIntegrals PowerSpectrum::oneLoop_diagrams(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, GridMode mode) const
+{
+   // integration method
+   LoopPhaseSpace phasespace(k, _UVcutoff, &kernels, PL, this);
+
+   // integration by the loop integration method (VEGAS via cuba by default), a component or a run per diagram
+   std::unique_ptr<IntegratorBase> integrator = make_integrator(2);
+
+   return integrator->integrate_diagrams(oneLoop_diagrams_integrand, &phasespace, &phasespace.diagram, _diagrams.names_oneLoop(), mode);
 }
    
 //------------------------------------------------------------------------------
@@ -58,6 +157,14 @@ double PowerSpectrum::treeEFT(double k, const LabelMap<Vertex, KernelBase*>& ker
       
    return _EFTdiagrams.value_tree(momenta, kernels, PL);
 }
+
+//------------------------------------------------------------------------------
+EFTbasis PowerSpectrum::treeEFT_basis(double k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   return EFTbasis::decompose(kernels, [&](const LabelMap<Vertex, KernelBase*>& unitkernels) {
+      return std::pair<double, double>(treeEFT(k, unitkernels, PL), 0.);
+   });
+}
    
 //------------------------------------------------------------------------------
 std::pair<double, LabelMap<Momentum, ThreeVector>* const> PowerSpectrum::LoopPhaseSpace::generate_point_oneLoop(std::vector<double> xpts)
@@ -118,13 +225,65 @@ int PowerSpectrum::oneLoop_integrand(const int *ndim, const double xx[], const i
    std::pair<double, LabelMap<Momentum, ThreeVector>* const> PSpoint = phasespace->generate_point_oneLoop(xpts);
 
    // calculate the integrand
-   double integrand = PSpoint.first * (phasespace->powerspectrum->diagrams()->value_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL));
+   double integrand = PSpoint.first * (phasespace->powerspectrum->diagrams()->value_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL, PSpoint.first));
 
    ff[0] = integrand;
 
    return 0;
 }
 
+//------------------------------------------------------------------------------
+int PowerSpectrum::oneLoop_kbins_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata)
+{
+   // get the integrator
+   LoopPhaseSpace* phasespace = static_cast<LoopPhaseSpace*>(userdata);
+
+   // generate the PS point, the loop momentum does not depend on k
+   std::vector<double> xpts;
+   for (int i = 0; i < phasespace->ndim; i++) {
+      xpts.push_back(xx[i]);
+   }
+   std::pair<double, LabelMap<Momentum, ThreeVector>* const> PSpoint = phasespace->generate_point_oneLoop(xpts);
+
+   // calculate the integrand in each k bin; the bins are different
+   // integrands, so they are not recorded in a profile
+   for (size_t i = 0; i < phasespace->kbins.size(); i++) {
+      phasespace->set_k(phasespace->kbins[i]);
+      ff[i] = PSpoint.first * (phasespace->powerspectrum->diagrams()->value_oneLoop_unprofiled(*(PSpoint.second), *(phasespace->kernels), phasespace->PL));
+   }
+
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+int PowerSpectrum::oneLoop_diagrams_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata)
+{
+   // get the integrator
+   LoopPhaseSpace* phasespace = static_cast<LoopPhaseSpace*>(userdata);
+
+   // generate the PS point
+   std::vector<double> xpts;
+   for (int i = 0; i < phasespace->ndim; i++) {
+      xpts.push_back(xx[i]);
+   }
+   std::pair<double, LabelMap<Momentum, ThreeVector>* const> PSpoint = phasespace->generate_point_oneLoop(xpts);
+
+   // a single diagram, or the total followed by each diagram
+   const DiagramSetBase* diagrams = phasespace->powerspectrum->diagrams();
+   if (phasespace->diagram >= 0) {
+      ff[0] = PSpoint.first * diagrams->value_oneLoop_diagram(phasespace->diagram, *(PSpoint.second), *(phasespace->kernels), phasespace->PL);
+   } else {
+      diagrams->values_oneLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL, ff + 1);
+      ff[0] = 0;
+      for (int i = 1; i < *ncomp; i++) {
+         ff[i] *= PSpoint.first;
+         ff[0] += ff[i];
+      }
+   }
+
+   return 0;
+}
+
 //------------------------------------------------------------------------------
 int PowerSpectrum::twoLoop_integrand(const int *ndim, const double xx[], const int *ncomp, double ff[], void *userdata)
 {
@@ -139,7 +298,7 @@ int PowerSpectrum::twoLoop_integrand(const int *ndim, const double xx[], const i
    std::pair<double, LabelMap<Momentum, ThreeVector>* const> PSpoint = phasespace->generate_point_twoLoop(xpts);
 
    // calculate the integrand
-   double integrand = PSpoint.first * (phasespace->powerspectrum->diagrams()->value_twoLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL));
+   double integrand = PSpoint.first * (phasespace->powerspectrum->diagrams()->value_twoLoop(*(PSpoint.second), *(phasespace->kernels), phasespace->PL, PSpoint.first));
 
    ff[0] = integrand;
 
@@ -25,10 +25,18 @@ namespace fnfast {
 
 //------------------------------------------------------------------------------
 Propagator::Propagator(LabelMap<Momentum, LabelFlow> components)
-: _components(components) {}
+: _components(components)
+{
+   // store the nonzero components by their slot in a flat momentum array
+   for (auto const& label : _components.labels()) {
+      if (_components[label] != LabelFlow::kNull) {
+         _slots.push_back(std::make_pair(MomentumView::slot(label), static_cast<int>(_components[label])));
+      }
+   }
+}
 
 //------------------------------------------------------------------------------
-ThreeVector Propagator::p(LabelMap<Momentum, ThreeVector> mom) const
+ThreeVector Propagator::p(const LabelMap<Momentum, ThreeVector>& mom) const
 {
    // output container
    ThreeVector pvec;
@@ -0,0 +1,174 @@
+//------------------------------------------------------------------------------
+/// \file ResultCache.cpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Implementation of class ResultCache
+//------------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <typeinfo>
+
+#include "ResultCache.hpp"
+#include "ThreeVector.hpp"
+
+namespace fnfast {
+
+// FNV-1a hash of a sequence of doubles
+static uint64_t hash_values(const std::vector<double>& values, uint64_t hash = 14695981039346656037ull)
+{
+   for (double value : values) {
+      unsigned char bytes[sizeof(double)];
+      std::memcpy(bytes, &value, sizeof(double));
+      for (unsigned char byte : bytes) {
+         hash ^= byte;
+         hash *= 1099511628211ull;
+      }
+   }
+   return hash;
+}
+
+// hash as 16 hex digits
+static std::string hex(uint64_t hash)
+{
+   std::ostringstream out;
+   out << std::hex << std::setw(16) << std::setfill('0') << hash;
+   return out.str();
+}
+
+//------------------------------------------------------------------------------
+ResultCache::ResultCache(const std::string& path) : _path(path), _hits(0), _misses(0)
+{
+   std::ifstream file(_path);
+   std::string line;
+   while (std::getline(file, line)) {
+      size_t tab = line.find('\t');
+      if (line.empty() || line[0] == '#' || tab == std::string::npos) { continue; }
+
+      std::istringstream values(line.substr(tab + 1));
+      int ncomp = 0;
+      values >> ncomp;
+      IntegralResults results(ncomp);
+      for (int i = 0; i < ncomp; i++) {
+         values >> results.result[i] >> results.error[i] >> results.prob[i];
+      }
+      // skip lines cut short by an interrupted write
+      if (values.fail()) { continue; }
+      _results[line.substr(0, tab)] = results;
+   }
+}
+
+//------------------------------------------------------------------------------
+bool ResultCache::find(const std::string& key, IntegralResults& results)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   auto it = _results.find(key);
+   if (it == _results.end()) {
+      _misses++;
+      return false;
+   }
+   _hits++;
+   results = it->second;
+   return true;
+}
+
+//------------------------------------------------------------------------------
+void ResultCache::store(const std::string& key, const IntegralResults& results)
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   _results[key] = results;
+
+   std::ostringstream line;
+   line << key << '\t' << results.size() << std::setprecision(17);
+   for (size_t i = 0; i < results.size(); i++) {
+      line << ' ' << results.result[i] << ' ' << results.error[i] << ' ' << results.prob[i];
+   }
+   line << '\n';
+
+   std::ofstream file(_path, std::ios::app);
+   file << line.str() << std::flush;
+}
+
+//------------------------------------------------------------------------------
+void ResultCache::store(const std::string& key, const IntegralResult& result)
+{
+   IntegralResults results(1);
+   results.result[0] = result.result;
+   results.error[0] = result.error;
+   results.prob[0] = result.prob;
+   store(key, results);
+}
+
+//------------------------------------------------------------------------------
+void ResultCache::clear()
+{
+   std::lock_guard<std::mutex> lock(_mutex);
+   _results.clear();
+   std::ofstream file(_path, std::ios::trunc);
+}
+
+//------------------------------------------------------------------------------
+std::string ResultCache::key(const std::string& observable, Order order, const std::vector<double>& config, double UVcutoff, double qmax,
+                             const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL, const IntegratorBase& integrator)
+{
+   std::ostringstream key;
+   key << std::setprecision(17) << observable << " order=" << static_cast<int>(order) << " config=";
+   for (size_t i = 0; i < config.size(); i++) {
+      key << (i ? "," : "") << config[i];
+   }
+   key << " UVcutoff=" << UVcutoff << " qmax=" << qmax
+       << " kernels=" << fingerprint(kernels)
+       << " PL=" << fingerprint(PL)
+       << " integrator=" << integrator.settings();
+   return key.str();
+}
+
+//------------------------------------------------------------------------------
+std::string ResultCache::fingerprint(const LabelMap<Vertex, KernelBase*>& kernels)
+{
+   // fixed momenta, generic enough that no kernel vanishes on them
+   std::vector<ThreeVector> p {ThreeVector(0.1, 0.2, 0.3), ThreeVector(-0.25, 0.05, 0.15), ThreeVector(0.05, -0.3, -0.1)};
+
+   std::string print;
+   for (Vertex vertex : {Vertex::v1, Vertex::v2, Vertex::v3, Vertex::v4}) {
+      if (!kernels.hasLabel(vertex)) { continue; }
+      KernelBase* kernel = kernels[vertex];
+      std::vector<double> values;
+      for (size_t n = 1; n <= p.size(); n++) {
+         std::vector<ThreeVector> pn(p.begin(), p.begin() + n);
+         values.push_back(kernel->Fn_sym(pn));
+         values.push_back(kernel->Gn_sym(pn));
+      }
+      print += (print.empty() ? "" : ",") + std::string("v") + std::to_string(static_cast<int>(vertex)) + ":"
+               + typeid(*kernel).name() + ":" + hex(hash_values(values));
+   }
+   return print;
+}
+
+//------------------------------------------------------------------------------
+std::string ResultCache::fingerprint(LinearPowerSpectrumBase* PL)
+{
+   const int npoints = 128;
+   std::vector<double> values;
+   for (int i = 0; i < npoints; i++) {
+      values.push_back((*PL)(pow(10., -5 + 8. * i / (npoints - 1))));
+   }
+   return hex(hash_values(values));
+}
+
+} // namespace fnfast
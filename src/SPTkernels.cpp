@@ -17,6 +17,9 @@
 //------------------------------------------------------------------------------
 
 #include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <utility>
 
@@ -26,109 +29,119 @@
 namespace fnfast {
 
 //------------------------------------------------------------------------------
-SPTkernels::SPTkernels()
+SPTkernels::SPTkernels(int nmax)
+: _nmax(0), _tabletime(0)
 {
-   // precompute useful quantities for fast evaluation up to n = 7
-   // higher n should never be needed, but easy to add if desired
-   // ----------------------------------------
-   // precompute alpha, beta coefficients
-   for (int c = 0; c <= 7; c++) {
-      _cFalpha[c] = cF_alpha(c);
-      _cFbeta[c] = cF_beta(c);
-      _cGalpha[c] = cG_alpha(c);
-      _cGbeta[c] = cG_beta(c);
-   }
+   // tables for no momenta: just the empty subset
+   _cFalpha.push_back(cF_alpha(0));
+   _cFbeta.push_back(cF_beta(0));
+   _cGalpha.push_back(cG_alpha(0));
+   _cGbeta.push_back(cG_beta(0));
+   _combfac.push_back(std::vector<double> (1, 1));
+   _subsetsize.push_back(0);
+   _pairoffsets = std::vector<int> (2, 0);
+
+   // precompute useful quantities for fast evaluation up to n = nmax
+   // higher n are added when first needed
+   reserve(nmax);
+}
 
-   // compute binomial coefficients
-   _binom = std::vector<std::vector<int> > (8);
-   for (int i = 0; i < 8; i++) {
-      // default fill all entries with 0
-      _binom[i] = std::vector<int> (i+1, 0);
-      for (int j = 0; j <= i; j++) {
-         // fill with actual values
-         _binom[i][j] = fact(i) / (fact(i - j) * fact(j));
+//------------------------------------------------------------------------------
+void SPTkernels::reserve(int n)
+{
+   if (n <= _nmax) { return; }
+   assert(n < static_cast<int>(8 * sizeof(unsigned int)));
+   auto start = std::chrono::steady_clock::now();
+
+   // precompute alpha, beta coefficients and combinatorial factors
+   for (int c = _nmax + 1; c <= n; c++) {
+      _cFalpha.push_back(cF_alpha(c));
+      _cFbeta.push_back(cF_beta(c));
+      _cGalpha.push_back(cG_alpha(c));
+      _cGbeta.push_back(cG_beta(c));
+      std::vector<double> combfac(c + 1);
+      for (int nA = 0; nA <= c; nA++) {
+         combfac[nA] = fact(nA) * fact(c - nA) / fact(c);
       }
+      _combfac.push_back(combfac);
    }
 
-   // compute permutation subsets, cache
-   _permset = std::vector<std::vector<std::vector<std::vector<int> > > > (8);
-   // i counts the total number of indices
-   for (int i = 1; i < 8; i++) {
-      // default fill each top level
-      _permset[i] = std::vector<std::vector<std::vector<int> > > (i+1);
-      for (int j = 1; j <= i; j++) {
-         // fill with actual values
-         _permset[i][j] = generate_permset(j, i);
+   // subset sizes, from the subset without its highest momentum
+   unsigned int nmasks = 1u << n;
+   _subsetsize.resize(nmasks);
+   for (int i = _nmax; i < n; i++) {
+      for (unsigned int mask = (1u << i); mask < (2u << i); mask++) {
+         _subsetsize[mask] = _subsetsize[mask - (1u << i)] + 1;
       }
    }
 
    // compute subset pairs, cache
-   _subsetpairs = std::vector<std::vector<std::vector<std::vector<SubsetPair> > > > (8);
-   // i indexes the number of total indices
-   for (int i = 1; i < 8; i++) {
-      // default fill the top level
-      _subsetpairs[i] = std::vector<std::vector<std::vector<SubsetPair> > > (i+1);
-      // j counts the number of indices in the subset
-      for (int j = 1; j <= i; j++) {
-         // container for all subsets of the given subset from j, i
-         std::vector<std::vector<SubsetPair> > subsetpairs_ij;
-         // generate all subsets of j indices built from i indices
-         std::vector<std::vector<int> > perms_ij = generate_permset(j, i);
-         // for each index subset, find all subset pairs of that subset
-         // remember we need the hashing function from i indices
-         for (auto perm : perms_ij) {
-            std::vector<SubsetPair> perm_pairs = generate_pairedsubsets(perm, i);
-            subsetpairs_ij.push_back(perm_pairs);
-         }
-         _subsetpairs[i][j] = subsetpairs_ij;
+   // for a subset with k momenta there are 2^{k-1} - 1 pairs of subsets,
+   // since each momentum is in one subset or the other, the highest momentum is
+   // always in subset B, and we ignore the full/empty case
+   // subset A runs over the nonempty subsets of the other momenta, in increasing order
+   unsigned int ntable = 1u << std::min(n, kTableN);
+   unsigned int oldntable = _pairoffsets.size() - 1;
+   _pairoffsets.pop_back();
+   for (unsigned int mask = oldntable; mask < ntable; mask++) {
+      _pairoffsets.push_back(_subsetpairs.size());
+      int k = _subsetsize[mask];
+      if (k < 2) { continue; }
+      unsigned int high = 1u;
+      while ((high << 1) <= mask) { high <<= 1; }
+      unsigned int rest = mask ^ high;
+      for (unsigned int maskA = rest & (0u - rest); maskA != 0; maskA = (maskA - rest) & rest) {
+         SubsetPair subsetpair;
+         subsetpair.maskA = maskA;
+         subsetpair.maskB = mask ^ maskA;
+         subsetpair.combfac = _combfac[k][_subsetsize[maskA]];
+         _subsetpairs.push_back(subsetpair);
       }
    }
+   _pairoffsets.push_back(_subsetpairs.size());
 
-   // fill the Fn_sym and Gn_sym arrays
-   _Fn_sym = std::vector<std::vector<std::vector<double> > > (8);
-   // n is the total number of indices (n for the kernel we're calculating)
-   for (int n = 1; n < 8; n++) {
-      // default fill the top level
-      _Fn_sym[n] = std::vector<std::vector<double> > (n+1);
-      // k is the number of indices in the daughter kernel calculations
-      // the ones in the recursion relation
-      for (int k = 1; k <= n; k++) {
-         _Fn_sym[n][k] = std::vector<double> (_permset[n][k].size(), 0);
-      }
-   }
-   _Gn_sym = _Fn_sym;
+   _nmax = n;
+   std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+   _tabletime += elapsed.count();
+}
+
+//------------------------------------------------------------------------------
+double SPTkernels::nsplits(int n)
+{
+   // sum over subsets of k momenta of the 2^{k-1} - 1 pairs of subsets
+   return (std::pow(3., n) + 1) / 2 - std::pow(2., n);
 }
 
 //------------------------------------------------------------------------------
-double SPTkernels::cF_alpha(int n)
+double SPTkernels::cF_alpha(int n) const
 {
    if (n < 2) { return 0; }
    return (2*n + 1.) / ((n - 1) * (2 * n + 3));
 }
 
 //------------------------------------------------------------------------------
-double SPTkernels::cF_beta(int n)
+double SPTkernels::cF_beta(int n) const
 {
    if (n < 2) { return 0; }
    return 2. / ((n - 1) * (2*n + 3));
 }
 
 //------------------------------------------------------------------------------
-double SPTkernels::cG_alpha(int n)
+double SPTkernels::cG_alpha(int n) const
 {
    if (n < 2) { return 0; }
    return 3. / ((n - 1) * (2*n + 3));
 }
 
 //------------------------------------------------------------------------------
-double SPTkernels::cG_beta(int n)
+double SPTkernels::cG_beta(int n) const
 {
    if (n < 2) { return 0; }
    return (2. * n) / ((n - 1) * (2*n + 3));
 }
 
 //------------------------------------------------------------------------------
-double SPTkernels::alpha(const ThreeVector& p1, const ThreeVector& p2)
+double SPTkernels::alpha(const ThreeVector& p1, const ThreeVector& p2) const
 {
    // handle the IR limit with an explicit cutoff
    double eps = 1e-12;
@@ -139,7 +152,7 @@ double SPTkernels::alpha(const ThreeVector& p1, const ThreeVector& p2)
 }
 
 //------------------------------------------------------------------------------
-double SPTkernels::beta(const ThreeVector& p1, const ThreeVector& p2)
+double SPTkernels::beta(const ThreeVector& p1, const ThreeVector& p2) const
 {
    // handle the IR limit with an explicit cutoff
    double eps = 1e-12;
@@ -149,30 +162,57 @@ double SPTkernels::beta(const ThreeVector& p1, const ThreeVector& p2)
    return ((p1 + p2)*(p1 + p2)) * (p1*p2) / (2 * (p1*p1) * (p2*p2));
 }
 
+//------------------------------------------------------------------------------
+DoubleBatch SPTkernels::alpha(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2) const
+{
+   // same as alpha(p1, p2) in each lane, with the IR cutoff
+   // selected per lane rather than by branching over the batch
+   double eps = 1e-12;
+   DoubleBatch p1p1 = p1 * p1;
+   DoubleBatch p2p1 = p2 * p1;
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) {
+      bool IR = (p1p1[i] < eps);
+      double denom = IR ? 1 : p1p1[i];
+      result[i] = IR ? 0 : 1 + p2p1[i] / denom;
+   }
+   return result;
+}
+
+//------------------------------------------------------------------------------
+DoubleBatch SPTkernels::beta(const ThreeVectorBatch& p1, const ThreeVectorBatch& p2) const
+{
+   // same as beta(p1, p2) in each lane, with the IR cutoff
+   // selected per lane rather than by branching over the batch
+   double eps = 1e-12;
+   ThreeVectorBatch p12 = p1 + p2;
+   DoubleBatch p12p12 = p12 * p12;
+   DoubleBatch p1p2 = p1 * p2;
+   DoubleBatch p1p1 = p1 * p1;
+   DoubleBatch p2p2 = p2 * p2;
+   DoubleBatch result;
+   for (int i = 0; i < kBatchWidth; i++) {
+      bool IR = (p1p1[i] < eps) || (p2p2[i] < eps);
+      double denom = IR ? 1 : 2 * p1p1[i] * p2p2[i];
+      result[i] = IR ? 0 : p12p12[i] * p1p2[i] / denom;
+   }
+   return result;
+}
+
 //------------------------------------------------------------------------------
 double SPTkernels::Fn_sym(const std::vector<ThreeVector>& p)
 {
    // calculates Fn_sym by calculating all lower multiplicity cases first
    // and using those results to build the requested case
    int n = p.size();
-
-   // need to do this in a specific order so that the higher multiplicity
-   // functions can use the lower multiplicity function results
-   // k represents the number of momenta in the set,
-   // e.g. for k = 3 we calculate F_3^sym (p1, p2, p3) + F_3^sym (p1, p2, p4) + ...
-   for (int k = 1; k < n; k++) {
-      // for every momentum permutation of k elements from the n,
-      // calculate the symmetrized Fn and Gn
-      for (size_t j = 0; j < _permset[n][k].size(); j++) {
-         _Fn_sym[n][k][j] = Fn_sym_build(p, _permset[n][k][j], j);
-         _Gn_sym[n][k][j] = Gn_sym_build(p, _permset[n][k][j], j);
-      }
-   }
+   reserve(n);
+   Workspace& ws = workspace();
+   build_subsets(p, n - 1, ws);
    // now calculate the main result
-   double result = Fn_sym_build(p, _permset[n][n][0], 0);
-   _Fn_sym[n][n][0] = result;
+   unsigned int mask = (1u << n) - 1;
+   sym_build(mask, ws);
 
-   return result;
+   return ws.Fn_sym[mask];
 }
 
 //------------------------------------------------------------------------------
@@ -181,199 +221,122 @@ double SPTkernels::Gn_sym(const std::vector<ThreeVector>& p)
    // calculates Gn_sym by calculating all lower multiplicity cases first
    // and using those results to build the requested case
    int n = p.size();
-
-   // need to do this in a specific order so that the higher multiplicity
-   // functions can use the lower multiplicity function results
-   // k represents the number of momenta in the set,
-   // e.g. for k = 3 we calculate F_3^sym (p1, p2, p3) + F_3^sym (p1, p2, p4) + ...
-   for (int k = 1; k < n; k++) {
-      // for every momentum permutation of k elements from the n,
-      // calculate the symmetrized Fn and Gn
-      for (size_t j = 0; j < _permset[n][k].size(); j++) {
-         _Fn_sym[n][k][j] = Fn_sym_build(p, _permset[n][k][j], j);
-         _Gn_sym[n][k][j] = Gn_sym_build(p, _permset[n][k][j], j);
-      }
-   }
+   reserve(n);
+   Workspace& ws = workspace();
+   build_subsets(p, n - 1, ws);
    // now calculate the main result
-   double result = Gn_sym_build(p, _permset[n][n][0], 0);
-   _Gn_sym[n][n][0] = result;
+   unsigned int mask = (1u << n) - 1;
+   sym_build(mask, ws);
 
-   return result;
+   return ws.Gn_sym[mask];
 }
 
 //------------------------------------------------------------------------------
-double SPTkernels::Fn_sym_build(const std::vector<ThreeVector>& p, const std::vector<int> indices, int hashvalue)
+void SPTkernels::sym_subsets(const std::vector<ThreeVector>& p, const std::vector<std::vector<int> >& subsets, std::vector<double>& Fn, std::vector<double>& Gn)
 {
-   // calculates Fn_sym using the results of lower multiplicity calculations
-   int n = p.size();
-   int k = indices.size();
-
-   // handle the base cases
-   if (k == 1) { return 1; }
-   if (k == 2) { return 0.5 * (_cFalpha[2] * (alpha(p[indices[0] - 1], p[indices[1] - 1])
-                                             + alpha(p[indices[1] - 1], p[indices[0] - 1]))
-                              + _cFbeta[2] * 2 * beta(p[indices[0] - 1], p[indices[1] - 1]));
-               } // note beta symmetric
-
-   // now do the recursion case
-   double result = 0;
-   // need to sum over all subsets of the given index set
-   for (const auto& subsetpair : _subsetpairs[n][k][hashvalue]) {
-      int nA = subsetpair.subsetA.size();
-      int nB = subsetpair.subsetB.size();
-      ThreeVector pA;
-      for (const auto& index : subsetpair.subsetA ) { pA += p[index - 1]; }
-      ThreeVector pB;
-      for (const auto& index : subsetpair.subsetB ) { pB += p[index - 1]; }
-      double combfac = 1. / _binom[k][nA];
-      // atomic quantities
-      double FnA = _Fn_sym[n][nA][subsetpair.hashA];
-      double FnB = _Fn_sym[n][nB][subsetpair.hashB];
-      double GnA = _Gn_sym[n][nA][subsetpair.hashA];
-      double GnB = _Gn_sym[n][nB][subsetpair.hashB];
-      double alphaAB = alpha(pA, pB);
-      double alphaBA = alpha(pB, pA);
-      double betaval = beta(pA, pB); // note beta symmetric
-      // add subset result
-      result += combfac * GnA * (_cFalpha[k] * alphaAB * FnB + _cFbeta[k] * betaval * GnB);
-      result += combfac * GnB * (_cFalpha[k] * alphaBA * FnA + _cFbeta[k] * betaval * GnA);
+   // the recursion for the kernels of the full pool computes the kernels
+   // of every subset along the way, so run it once up to the largest
+   // requested subset and read off all the requested results
+   int kmax = 0;
+   for (auto& subset : subsets) {
+      kmax = std::max(kmax, static_cast<int>(subset.size()));
+   }
+   reserve(p.size());
+   Workspace& ws = workspace();
+   build_subsets(p, kmax, ws);
+
+   Fn.clear();
+   Gn.clear();
+   for (auto& subset : subsets) {
+      unsigned int mask = 0;
+      for (auto index : subset) { mask |= (1u << index); }
+      Fn.push_back(ws.Fn_sym[mask]);
+      Gn.push_back(ws.Gn_sym[mask]);
    }
-
-   return result;
 }
 
 //------------------------------------------------------------------------------
-double SPTkernels::Gn_sym_build(const std::vector<ThreeVector>& p, const std::vector<int> indices, int hashvalue)
+SPTkernels::Workspace& SPTkernels::workspace()
 {
-   // calculates Fn_sym using the results of lower multiplicity calculations
-   int n = p.size();
-   int k = indices.size();
-
-   // handle the base cases
-   if (k == 1) { return 1; }
-   if (k == 2) { return 0.5 * (_cGalpha[2] * (alpha(p[indices[0] - 1], p[indices[1] - 1])
-                                             + alpha(p[indices[1] - 1], p[indices[0] - 1]))
-                              + _cGbeta[2] * 2 * beta(p[indices[0] - 1], p[indices[1] - 1]));
-               } // note beta symmetric
-
-   // now do the recursion case
-   double result = 0;
-   // need to sum over all subsets of the given index set
-   for (const auto& subsetpair : _subsetpairs[n][k][hashvalue]) {
-      int nA = subsetpair.subsetA.size();
-      int nB = subsetpair.subsetB.size();
-      ThreeVector pA;
-      for (const auto& index : subsetpair.subsetA ) { pA += p[index - 1]; }
-      ThreeVector pB;
-      for (const auto& index : subsetpair.subsetB ) { pB += p[index - 1]; }
-      double combfac = 1. / _binom[k][nA];
-      // atomic quantities
-      double FnA = _Fn_sym[n][nA][subsetpair.hashA];
-      double FnB = _Fn_sym[n][nB][subsetpair.hashB];
-      double GnA = _Gn_sym[n][nA][subsetpair.hashA];
-      double GnB = _Gn_sym[n][nB][subsetpair.hashB];
-      double alphaAB = alpha(pA, pB);
-      double alphaBA = alpha(pB, pA);
-      double betaval = beta(pA, pB); // note beta symmetric
-      // add subset result
-      result += combfac * GnA * (_cGalpha[k] * alphaAB * FnB + _cGbeta[k] * betaval * GnB);
-      result += combfac * GnB * (_cGalpha[k] * alphaBA * FnA + _cGbeta[k] * betaval * GnA);
-   }
-
-   return result;
+   static thread_local Workspace ws;
+   return ws;
 }
 
 //------------------------------------------------------------------------------
-std::vector<std::vector<int> > SPTkernels::generate_permset(int k, int n)
+void SPTkernels::build_subsets(const std::vector<ThreeVector>& p, int kmax, Workspace& ws) const
 {
-   std::vector<std::vector<int> > permset;
-   int index = 1;
-   int maxindex = n - k + 1;
-   // seed the permutation set with the first index
-   for (int i = index; i <= maxindex; i++) {
-      permset.push_back(std::vector<int> {i});
+   int n = p.size();
+   unsigned int nmasks = 1u << n;
+   if (ws.psum.size() < nmasks) {
+      ws.psum.resize(nmasks);
+      ws.psq.resize(nmasks, 0);
+      ws.Fn_sym.resize(nmasks, 0);
+      ws.Gn_sym.resize(nmasks, 0);
    }
-   index++;
-   maxindex++;
-   // loop over spots in the permset up to k
-   while (index <= k) {
-      std::vector<std::vector<int> > permset_iter;
-      // loop over existing vectors
-      for (auto elem : permset) {
-         int minindex = elem.back() + 1;
-         for (int i = minindex; i <= maxindex; i++) {
-            permset_iter.push_back(elem);
-            permset_iter.back().push_back(i);
-         }
+   // momentum sums of all subsets: add the highest momentum
+   // of each subset to the sum of the remaining ones
+   for (int i = 0; i < n; i++) {
+      for (unsigned int mask = (1u << i); mask < (2u << i); mask++) {
+         ws.psum[mask] = ws.psum[mask - (1u << i)] + p[i];
+         ws.psq[mask] = ws.psum[mask] * ws.psum[mask];
       }
-      // move onto the next spot
-      permset = std::move(permset_iter);
-      index++;
-      maxindex++;
    }
-   return permset;
+   // every proper subset of a subset has a lower bitmask,
+   // so in increasing order the lower multiplicity results
+   // are always available when building a subset
+   for (unsigned int mask = 1; mask < nmasks; mask++) {
+      if (_subsetsize[mask] > kmax) { continue; }
+      sym_build(mask, ws);
+   }
 }
 
 //------------------------------------------------------------------------------
-std::vector<SPTkernels::SubsetPair> SPTkernels::generate_pairedsubsets(const std::vector<int>& indices, int nmax)
+void SPTkernels::sym_build(unsigned int mask, Workspace& ws) const
 {
-   int n = indices.size();
-   // output container
-   std::vector<SubsetPair> subsets;
-   // there are 2^{n-1} - 1 total pairs of subsets
-   // since each index is in one set or the other (and we ignore the full/empty case)
-   int totpairs = int_pow(2, n-1) - 1;
-   subsets.reserve(totpairs);
-   // construct the subsets explicity using the binary representation of
-   for (int i = 1; i <= totpairs; i++) {
-      std::vector<int> subsetA;
-      std::vector<int> subsetB;
-      for (int j = 0; j < n; j++) {
-         // look at the j^th bit of the pair number
-         // 1: subset A, 0: subset B
-         if ((i & (1 << j)) != 0) {
-            subsetA.push_back(indices[j]);
-         } else {
-            subsetB.push_back(indices[j]);
-         }
-      }
-      // hash the subsets
-      int hashA = hash_perm(subsetA, nmax);
-      int hashB = hash_perm(subsetB, nmax);
-      SubsetPair subsetpair(subsetA, hashA, subsetB, hashB);
-      subsets.push_back(subsetpair);
+   // calculates Fn_sym and Gn_sym using the results of lower multiplicity calculations
+   int k = _subsetsize[mask];
+
+   // handle the base cases
+   if (k == 1) {
+      ws.Fn_sym[mask] = 1;
+      ws.Gn_sym[mask] = 1;
+      return;
+   }
+   if (k == 2) {
+      unsigned int mask1 = mask & (0u - mask);
+      unsigned int mask2 = mask ^ mask1;
+      double alpha12, alpha21, betaval;
+      alpha_beta(ws.psq[mask1], ws.psq[mask2], ws.psum[mask1]*ws.psum[mask2], ws.psq[mask], alpha12, alpha21, betaval); // note beta symmetric
+      double alphasum = alpha12 + alpha21;
+      ws.Fn_sym[mask] = 0.5 * (_cFalpha[2] * alphasum + _cFbeta[2] * 2 * betaval);
+      ws.Gn_sym[mask] = 0.5 * (_cGalpha[2] * alphasum + _cGbeta[2] * 2 * betaval);
+      return;
    }
-   return subsets;
-}
 
-//------------------------------------------------------------------------------
-int SPTkernels::hash_perm(const std::vector<int>& indices, int nmax)
-{
-   int nslots = indices.size();
-   // trivial cases
-   if (nslots == 0) { return 0; }
-   if (nslots == 1) { return indices[0] - 1; }
-   // function to find the number of the index subset in a lexicographic ordering
-   // serves as a monotone minimal perfect hash
-   // example: 2-index subset out of 4 indices
-   // order: [1,2], [1,3], [1,4], [2,3], [2,4], [3,4]
-   int navail = nmax;
-   int minindex = 1;
-   size_t pos = 0;
-   int value = 0;
-   // step through the index list
-   while (pos < indices.size()) {
-      // compute the number of skips
-      int nskip = indices[pos] - minindex;
-      value += _binom[navail][nslots] - _binom[navail - nskip][nslots];
-      // step forward in the vector
-      minindex = indices[pos] + 1;
-      navail = nmax - minindex + 1;
-      nslots--;
-      pos++;
+   // now do the recursion case
+   double Fn = 0;
+   double Gn = 0;
+   // need to sum over all subsets of the given index set
+   if (mask + 1 < _pairoffsets.size()) {
+      const SubsetPair* pair = &_subsetpairs[0] + _pairoffsets[mask];
+      const SubsetPair* end = &_subsetpairs[0] + _pairoffsets[mask + 1];
+      for (; pair != end; pair++) {
+         add_split(*pair, k, ws, Fn, Gn);
+      }
+   } else {
+      // beyond the table, enumerate the pairs in the same order
+      unsigned int high = 1u;
+      while ((high << 1) <= mask) { high <<= 1; }
+      unsigned int rest = mask ^ high;
+      SubsetPair pair;
+      for (pair.maskA = rest & (0u - rest); pair.maskA != 0; pair.maskA = (pair.maskA - rest) & rest) {
+         pair.maskB = mask ^ pair.maskA;
+         pair.combfac = _combfac[k][_subsetsize[pair.maskA]];
+         add_split(pair, k, ws, Fn, Gn);
+      }
    }
-   return value;
+   ws.Fn_sym[mask] = Fn;
+   ws.Gn_sym[mask] = Gn;
 }
 
-
 } // namespace fnfast
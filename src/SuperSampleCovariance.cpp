@@ -0,0 +1,76 @@
+//------------------------------------------------------------------------------
+/// \file SuperSampleCovariance.cpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Implementation of class SuperSampleCovariance
+//------------------------------------------------------------------------------
+
+#include <cmath>
+
+#include "SuperSampleCovariance.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+double SuperSampleCovariance::sigma_b2(LinearPowerSpectrumBase* PL) const
+{
+   // the shell integrals carry 1/((2pi)^3 V), one more 1/V for sigma_b^2
+   const std::vector<double>& s = _window.window_shells();
+   const std::vector<double>& mass = _window.window_masses();
+   double sigma2 = 0;
+   for (size_t i = 0; i < s.size(); i++) {
+      if (mass[i] > 0) { sigma2 += mass[i] * (*PL)(s[i]); }
+   }
+
+   return sigma2 / _window.volume();
+}
+
+//------------------------------------------------------------------------------
+double SuperSampleCovariance::response(double k, LinearPowerSpectrumBase* PL) const
+{
+   // logarithmic slope of the linear power spectrum from a central difference
+   const double eps = 1e-3;
+   double dlnP = log((*PL)(k * exp(eps)) / (*PL)(k * exp(-eps))) / (2 * eps);
+
+   // growth (26/21) and dilation (-1/3 dln(k^3 P)/dlnk = -1 - dlnP/3) from the squeezed
+   // trispectrum, plus the reference density (2): 26/21 + 2 - 1 - dlnP/3 = 47/21 - dlnP/3
+   return 47. / 21 - dlnP / 3;
+}
+
+//------------------------------------------------------------------------------
+double SuperSampleCovariance::covariance(double k, double kprime, LinearPowerSpectrumBase* PL) const
+{
+   return sigma_b2(PL) * response(k, PL) * response(kprime, PL) * (*PL)(k) * (*PL)(kprime);
+}
+
+//------------------------------------------------------------------------------
+std::vector<std::vector<double> > SuperSampleCovariance::covariance(const std::vector<double>& k, LinearPowerSpectrumBase* PL) const
+{
+   // Cov_SSC is the outer product of R(k) P(k)
+   double sigma2 = sigma_b2(PL);
+   std::vector<double> RP;
+   for (auto ki : k) {
+      RP.push_back(response(ki, PL) * (*PL)(ki));
+   }
+   std::vector<std::vector<double> > cov(k.size(), std::vector<double>(k.size()));
+   for (size_t i = 0; i < k.size(); i++) {
+      for (size_t j = 0; j < k.size(); j++) {
+         cov[i][j] = sigma2 * RP[i] * RP[j];
+      }
+   }
+
+   return cov;
+}
+
+} // namespace fnfast
@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------
+/// \file WindowFunctionRadial.cpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Implementation of class WindowFunctionRadial
+//------------------------------------------------------------------------------
+
+#include "WindowFunctionRadial.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+WindowFunctionRadial::WindowFunctionRadial(const WindowFunctionBase& W, double xmax, int n)
+: _h(xmax / (n - 1)), _table(n)
+{
+   for (int j = 0; j < n; j++) {
+      _table[j] = W(ThreeVector(0, 0, j * _h));
+   }
+}
+
+//------------------------------------------------------------------------------
+WindowFunctionRadial::WindowFunctionRadial(const std::vector<double>& values, double xmax)
+: _h(xmax / (values.size() - 1)), _table(values)
+{}
+
+} // namespace fnfast
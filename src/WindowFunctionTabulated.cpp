@@ -0,0 +1,35 @@
+//------------------------------------------------------------------------------
+/// \file WindowFunctionTabulated.cpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Implementation of class WindowFunctionTabulated
+//------------------------------------------------------------------------------
+
+#include "WindowFunctionTabulated.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+WindowFunctionTabulated::WindowFunctionTabulated(const WindowFunctionSeparable& W, double xmax, int n)
+: WindowFunctionSeparable(W.volume()), _xmax(xmax), _h(2 * xmax / (n - 1))
+{
+   for (int i = 0; i < 3; i++) {
+      _tables[i].resize(n);
+      for (int j = 0; j < n; j++) {
+         _tables[i][j] = W.axis(i, -xmax + j * _h);
+      }
+   }
+}
+
+} // namespace fnfast
@@ -0,0 +1,173 @@
+//------------------------------------------------------------------------------
+/// \file WindowedPowerSpectrum.cpp
+//
+// Author(s):
+//    Jon Walsh
+//
+// Copyright:
+//    Copyright (C) 2015  LBL
+//
+//    This file is part of the EFTofLSS library. EFTofLSS is distributed under the
+//    terms of the GNU General Public License version 3 (GPLv3), see the COPYING
+//    file that comes with this distribution for details.
+//    Please respect the academic usage guidelines in the GUIDELINES file.
+//
+// Description:
+//    Implementation of class WindowedPowerSpectrum
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <cmath>
+
+#include "WindowedPowerSpectrum.hpp"
+
+namespace fnfast {
+
+//------------------------------------------------------------------------------
+WindowedPowerSpectrum::WindowedPowerSpectrum(const WindowFunctionBase& W, double volume, double smax, int ns, int ngrid)
+: _volume(volume), _s(ns, 0), _mass(ns, 0)
+{
+   // sum |W|^2 over the cell centers, binned by |s|; the window is evaluated
+   // in batches, one row along the 3-axis at a time
+   double h = 2 * smax / ngrid;
+   double ds = smax / ns;
+   double norm = h*h*h / (8 * pi*pi*pi * _volume);
+   std::vector<double> moment(ns, 0);
+   std::vector<ThreeVector> row(ngrid);
+   std::vector<double> wrow(ngrid);
+   for (int i = 0; i < ngrid; i++) {
+      double sx = -smax + (i + 0.5) * h;
+      for (int j = 0; j < ngrid; j++) {
+         double sy = -smax + (j + 0.5) * h;
+         for (int l = 0; l < ngrid; l++) {
+            row[l] = ThreeVector(sx, sy, -smax + (l + 0.5) * h);
+         }
+         W.evaluate(row.data(), wrow.data(), ngrid);
+         for (int l = 0; l < ngrid; l++) {
+            double sz = row[l].p3();
+            double s = sqrt(sx*sx + sy*sy + sz*sz);
+            int shell = s / ds;
+            if (shell >= ns) { continue; }
+            double w = wrow[l];
+            _mass[shell] += norm * w * w;
+            moment[shell] += norm * w * w * s;
+         }
+      }
+   }
+   // mean radius of each shell
+   for (int shell = 0; shell < ns; shell++) {
+      _s[shell] = (_mass[shell] > 0) ? moment[shell] / _mass[shell] : (shell + 0.5) * ds;
+   }
+}
+
+//------------------------------------------------------------------------------
+double WindowedPowerSpectrum::window_norm() const
+{
+   double norm = 0;
+   for (auto mass : _mass) { norm += mass; }
+   return norm;
+}
+
+//------------------------------------------------------------------------------
+std::vector<double> WindowedPowerSpectrum::convolve(const std::vector<double>& knodes, const std::vector<double>& Pnodes, const std::vector<double>& k) const
+{
+   // the spectrum goes to zero at k = 0
+   std::vector<double> knodes0 = knodes;
+   std::vector<double> Pnodes0 = Pnodes;
+   if (knodes0.empty() || knodes0[0] > 0) {
+      knodes0.insert(knodes0.begin(), 0);
+      Pnodes0.insert(Pnodes0.begin(), 0);
+   }
+   std::vector<double> Hnodes = cumulative(knodes0, Pnodes0);
+
+   std::vector<double> PW(k.size(), 0);
+   for (size_t ik = 0; ik < k.size(); ik++) {
+      double sum = 0;
+      for (size_t i = 0; i < _s.size(); i++) {
+         double s = _s[i];
+         // average of P(|k - s|) over the angle between k and s,
+         // [H(k + s) - H(|k - s|)] / (2 k s), which is P(s) for k = 0 and P(k) for s = 0
+         double Pavg;
+         if (k[ik] > 0 && s > 0) {
+            Pavg = (cumulative(k[ik] + s, knodes0, Pnodes0, Hnodes) - cumulative(std::abs(k[ik] - s), knodes0, Pnodes0, Hnodes)) / (2 * k[ik] * s);
+         } else {
+            Pavg = interpolate(k[ik] + s, knodes0, Pnodes0);
+         }
+         sum += _mass[i] * Pavg;
+      }
+      PW[ik] = sum;
+   }
+
+   return PW;
+}
+
+//------------------------------------------------------------------------------
+std::vector<double> WindowedPowerSpectrum::tree(const PowerSpectrum& PS, const std::vector<double>& knodes, const std::vector<double>& k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   std::vector<double> Pnodes;
+   for (auto knode : knodes) {
+      Pnodes.push_back(PS.tree(knode, kernels, PL));
+   }
+
+   return convolve(knodes, Pnodes, k);
+}
+
+//------------------------------------------------------------------------------
+IntegralResults WindowedPowerSpectrum::oneLoop(const PowerSpectrum& PS, const std::vector<double>& knodes, const std::vector<double>& k, const LabelMap<Vertex, KernelBase*>& kernels, LinearPowerSpectrumBase* PL) const
+{
+   // the nodes are the components of a single integration
+   IntegralResults nodes = PS.oneLoop(knodes, kernels, PL);
+   double prob = 0;
+   for (auto p : nodes.prob) {
+      prob = std::max(prob, p);
+   }
+
+   // the convolution is linear with positive weights, so the convolved errors bound the errors
+   IntegralResults results;
+   results.result = convolve(knodes, nodes.result, k);
+   results.error = convolve(knodes, nodes.error, k);
+   results.prob.assign(k.size(), prob);
+
+   return results;
+}
+
+//------------------------------------------------------------------------------
+std::vector<double> WindowedPowerSpectrum::cumulative(const std::vector<double>& knodes, const std::vector<double>& Pnodes)
+{
+   std::vector<double> Hnodes(knodes.size(), 0);
+   for (size_t j = 1; j < knodes.size(); j++) {
+      double a = knodes[j-1];
+      double d = knodes[j] - a;
+      double m = (Pnodes[j] - Pnodes[j-1]) / d;
+      Hnodes[j] = Hnodes[j-1] + Pnodes[j-1] * (a * d + d*d / 2) + m * (a * d*d / 2 + d*d*d / 3);
+   }
+
+   return Hnodes;
+}
+
+//------------------------------------------------------------------------------
+double WindowedPowerSpectrum::cumulative(double q, const std::vector<double>& knodes, const std::vector<double>& Pnodes, const std::vector<double>& Hnodes)
+{
+   // zero beyond the last node
+   if (q >= knodes.back()) { q = knodes.back(); }
+   if (q <= knodes.front()) { return 0; }
+   // segment [a, b] containing q, where P = Pa + m (q - a)
+   size_t j = std::upper_bound(knodes.begin(), knodes.end(), q) - knodes.begin() - 1;
+   if (j + 1 == knodes.size()) { j--; }
+   double a = knodes[j];
+   double m = (Pnodes[j+1] - Pnodes[j]) / (knodes[j+1] - a);
+   double d = q - a;
+
+   // int_a^q dq' q' (Pa + m (q' - a))
+   return Hnodes[j] + Pnodes[j] * (a * d + d*d / 2) + m * (a * d*d / 2 + d*d*d / 3);
+}
+
+//------------------------------------------------------------------------------
+double WindowedPowerSpectrum::interpolate(double q, const std::vector<double>& knodes, const std::vector<double>& Pnodes)
+{
+   if (q >= knodes.back() || q < knodes.front()) { return 0; }
+   size_t j = std::upper_bound(knodes.begin(), knodes.end(), q) - knodes.begin() - 1;
+   return Pnodes[j] + (Pnodes[j+1] - Pnodes[j]) * (q - knodes[j]) / (knodes[j+1] - knodes[j]);
+}
+
+} // namespace fnfast
@@ -0,0 +1,282 @@
+//------------------------------------------------------------------------------
+// benchmark suite of the EFTofLSS library
+//
+// usage: bench [--json] [--min-time seconds] [--nmax n] [--no-integrals] [filter]
+//
+// micro-benchmarks of the kernels (SPT Fn_sym for n = 1..nmax, default 10,
+// and Gn_sym for n = 1..7, EFT Fn_sym for n = 1..3), Propagator::p, LabelMap
+// operations and a single DiagramOneLoop::value call, followed by the full one
+// loop power spectrum (at a single k, at 8 k bins in one integration and with
+// the QMC methods), bispectrum and covariance integrals.  For each benchmark it
+// reports the time per call, calls per second, and heap allocations and bytes
+// per call (counted by replacing the global operator new).  The SPT Fn_sym
+// benchmarks also report the time to build the kernel tables for n momenta,
+// the number of subset pairs the recursion visits and the time per pair, which
+// should be roughly flat in n since the pairs grow as 3^n.  With --json each
+// benchmark is one JSON object per line, for tracking across versions; only
+// benchmarks whose name contains the filter are run.
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "SPTkernels.hpp"
+#include "EFTkernels.hpp"
+#include "ThreeVector.hpp"
+#include "ThreeVectorBatch.hpp"
+#include "Propagator.hpp"
+#include "LabelMap.hpp"
+#include "PowerSpectrum.hpp"
+#include "Bispectrum.hpp"
+#include "Covariance.hpp"
+#include "LinearPowerSpectrumAnalytic.hpp"
+
+using namespace fnfast;
+
+//------------------------------------------------------------------------------
+// allocation counting
+//------------------------------------------------------------------------------
+static size_t allocations = 0;
+static size_t allocated_bytes = 0;
+
+// counted allocation, nullptr if it fails
+static void* allocate(size_t size) noexcept
+{
+   allocations++;
+   allocated_bytes += size;
+   return std::malloc(size ? size : 1);
+}
+
+// release of an allocation, not inlined into the delete expressions, so that
+// the compiler sees operator delete rather than free matched with operator new
+__attribute__((noinline)) static void deallocate(void* p) noexcept { std::free(p); }
+
+// all replaceable forms, so that every new expression is counted and each
+// delete expression pairs with its new
+void* operator new(size_t size)
+{
+   void* p = allocate(size);
+   if (!p) { throw std::bad_alloc(); }
+   return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+
+//------------------------------------------------------------------------------
+// benchmark driver
+//------------------------------------------------------------------------------
+struct Options
+{
+   bool json = false;            ///< one JSON object per benchmark
+   double min_time = 0.2;        ///< minimum run time of each micro-benchmark [s]
+   int nmax = 10;                ///< largest n of the SPT Fn_sym benchmarks
+   bool integrals = true;        ///< run the full integrals
+   std::string filter;           ///< only run benchmarks whose name contains this
+};
+
+// additional results of a benchmark, as (name, value)
+typedef std::vector<std::pair<std::string, double> > Fields;
+
+static Options options;
+static volatile double sink = 0;    ///< keeps the benchmarked results alive
+
+// times calls of f, which returns a value to keep and does calls_per_run calls,
+// for at least the minimum time (a single run for min_time = 0); fields, if
+// given, returns additional results from the time per call in ns
+static void run(const std::string& name, std::function<double()> f, int calls_per_run = 1, double min_time = -1, std::function<Fields(double)> fields = nullptr)
+{
+   if (name.find(options.filter) == std::string::npos) { return; }
+   if (min_time < 0) { min_time = options.min_time; }
+
+   sink = sink + f();    // warm up: tables, caches
+   size_t allocations0 = allocations;
+   size_t bytes0 = allocated_bytes;
+   long runs = 0;
+   double elapsed = 0;
+   double sum = 0;
+   auto start = std::chrono::steady_clock::now();
+   do {
+      sum += f();
+      runs++;
+      elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   } while (elapsed < min_time);
+   sink = sink + sum;
+
+   double calls = static_cast<double>(runs) * calls_per_run;
+   double ns = 1e9 * elapsed / calls;
+   double allocs = (allocations - allocations0) / calls;
+   double bytes = (allocated_bytes - bytes0) / calls;
+   Fields extra;
+   if (fields) { extra = fields(ns); }
+   if (options.json) {
+      std::cout << "{\"bench\": \"" << name << "\", \"ns_per_call\": " << ns
+                << ", \"calls_per_sec\": " << 1e9 / ns
+                << ", \"allocs_per_call\": " << allocs
+                << ", \"bytes_per_call\": " << bytes
+                << ", \"calls\": " << calls;
+      for (auto& field : extra) { std::cout << ", \"" << field.first << "\": " << field.second; }
+      std::cout << "}" << std::endl;
+   } else {
+      std::cout << std::left << std::setw(36) << name << std::right
+                << std::setw(16) << ns
+                << std::setw(16) << 1e9 / ns
+                << std::setw(14) << allocs
+                << std::setw(14) << bytes;
+      for (auto& field : extra) { std::cout << "  " << field.first << "=" << field.second; }
+      std::cout << std::endl;
+   }
+}
+
+// main routine
+int main(int argc, char* argv[])
+{
+   for (int i = 1; i < argc; i++) {
+      if (!std::strcmp(argv[i], "--json")) { options.json = true; }
+      else if (!std::strcmp(argv[i], "--no-integrals")) { options.integrals = false; }
+      else if (!std::strcmp(argv[i], "--min-time") && i + 1 < argc) { options.min_time = std::atof(argv[++i]); }
+      else if (!std::strcmp(argv[i], "--nmax") && i + 1 < argc) { options.nmax = std::atoi(argv[++i]); }
+      else { options.filter = argv[i]; }
+   }
+
+   if (options.json) {
+      std::cout << "{\"bench\": \"meta\", \"batch_width\": " << kBatchWidth
+                << ", \"compiler\": \"" << __VERSION__ << "\"}" << std::endl;
+   } else {
+      std::cout << std::left << std::setw(36) << "benchmark" << std::right
+                << std::setw(16) << "ns/call"
+                << std::setw(16) << "calls/s"
+                << std::setw(14) << "allocs/call"
+                << std::setw(14) << "bytes/call" << std::endl;
+   }
+
+   // random momenta, drawn once so that the benchmarks time the kernels only
+   std::mt19937 rng(37);
+   std::uniform_real_distribution<double> uniform(-1, 1);
+   const int npoints = 64;
+   std::vector<std::vector<ThreeVector> > points(npoints, std::vector<ThreeVector>(std::max(options.nmax, 7)));
+   for (auto& p : points) {
+      for (auto& pi : p) { pi = ThreeVector(uniform(rng), uniform(rng), uniform(rng)); }
+   }
+
+   //---------------------------------------------------------------------------
+   // kernels
+   //---------------------------------------------------------------------------
+   SPTkernels spt;
+   for (int n = 1; n <= std::max(options.nmax, 7); n++) {
+      std::vector<std::vector<ThreeVector> > p;
+      for (auto& point : points) { p.push_back(std::vector<ThreeVector>(point.begin(), point.begin() + n)); }
+      if (n <= options.nmax) {
+         // fresh kernels, so the table time is the construction time for n momenta
+         SPTkernels sptn(n);
+         double pairs = SPTkernels::nsplits(n);
+         run("SPTkernels::Fn_sym n=" + std::to_string(n), [&]() {
+            double sum = 0;
+            for (auto& pi : p) { sum += sptn.Fn_sym(pi); }
+            return sum;
+         }, npoints, -1, [&](double ns) {
+            return Fields {{"table_ms", 1e3 * sptn.table_time()}, {"pairs", pairs}, {"ns_per_pair", (pairs > 0) ? ns / pairs : 0}};
+         });
+      }
+      if (n <= 7) {
+         run("SPTkernels::Gn_sym n=" + std::to_string(n), [&]() {
+            double sum = 0;
+            for (auto& pi : p) { sum += spt.Gn_sym(pi); }
+            return sum;
+         }, npoints);
+      }
+   }
+
+   EFTcoefficients coefficients;
+   coefficients[EFTcoefficients::cs] = 10;
+   coefficients[EFTcoefficients::c1] = -2;
+   coefficients[EFTcoefficients::t2] = 5;
+   coefficients[EFTcoefficients::d1] = 1;
+   EFTkernels eft(coefficients);
+   for (int n = 1; n <= 3; n++) {
+      std::vector<std::vector<ThreeVector> > p;
+      for (auto& point : points) { p.push_back(std::vector<ThreeVector>(point.begin(), point.begin() + n)); }
+      run("EFTkernels::Fn_sym n=" + std::to_string(n), [&]() {
+         double sum = 0;
+         for (auto& pi : p) { sum += eft.Fn_sym(pi); }
+         return sum;
+      }, npoints);
+   }
+
+   //---------------------------------------------------------------------------
+   // propagators and label maps
+   //---------------------------------------------------------------------------
+   Propagator propagator(LabelMap<Momentum, Propagator::LabelFlow> {{Momentum::q, Propagator::LabelFlow::kMinus}, {Momentum::k1, Propagator::LabelFlow::kPlus}, {Momentum::k2, Propagator::LabelFlow::kPlus}});
+   LabelMap<Momentum, ThreeVector> mom {{Momentum::q, points[0][0]}, {Momentum::k1, points[0][1]}, {Momentum::k2, points[0][2]}, {Momentum::k3, points[0][3]}, {Momentum::k4, points[0][4]}};
+   ThreeVector flatmom[MomentumView::kNumSlots];
+   MomentumView::flatten(mom, flatmom);
+   MomentumView view(flatmom, MomentumView::identity());
+   run("Propagator::p LabelMap", [&]() { return propagator.p(mom).p1(); });
+   run("Propagator::p MomentumView", [&]() { return propagator.p(view).p1(); });
+
+   run("LabelMap::operator[]", [&]() { return mom[Momentum::k2].p1() + mom[Momentum::q].p2(); }, 2);
+   run("LabelMap construct 5 labels", [&]() {
+      LabelMap<Momentum, ThreeVector> m {{Momentum::q, points[0][0]}, {Momentum::k1, points[0][1]}, {Momentum::k2, points[0][2]}, {Momentum::k3, points[0][3]}, {Momentum::k4, points[0][4]}};
+      return m[Momentum::k1].p1();
+   });
+   run("LabelMap copy 5 labels", [&]() {
+      LabelMap<Momentum, ThreeVector> m = mom;
+      return m[Momentum::k1].p1();
+   });
+
+   //---------------------------------------------------------------------------
+   // diagrams
+   //---------------------------------------------------------------------------
+   LinearPowerSpectrumAnalytic PL(1);
+   PowerSpectrum PS(Order::kOneLoop);
+   Bispectrum BS(Order::kOneLoop);
+   Covariance CV(Order::kOneLoop);
+   PS.set_qmax(2);
+   BS.set_qmax(2);
+   CV.set_qmax(2);
+
+   LabelMap<Vertex, KernelBase*> kernels2 {{Vertex::v1, &spt}, {Vertex::v2, &spt}};
+   LabelMap<Vertex, KernelBase*> kernels3 {{Vertex::v1, &spt}, {Vertex::v2, &spt}, {Vertex::v3, &spt}};
+   LabelMap<Vertex, KernelBase*> kernels4 {{Vertex::v1, &spt}, {Vertex::v2, &spt}, {Vertex::v3, &spt}, {Vertex::v4, &spt}};
+   ThreeVector q(0.3, -0.2, 0.45), ka(0, 0, 0.2), kb(0.1, 0.05, -0.12);
+   LabelMap<Momentum, ThreeVector> mom2 {{Momentum::k1, -ka}, {Momentum::k2, ka}, {Momentum::q, q}};
+   LabelMap<Momentum, ThreeVector> mom4 {{Momentum::k1, ka}, {Momentum::k2, -ka}, {Momentum::k3, kb}, {Momentum::k4, -kb}, {Momentum::q, q}};
+
+   const DiagramOneLoop* diagram = PS.diagrams()->oneLoop()[0];
+   run("DiagramOneLoop::value P22", [&]() { return diagram->value(mom2, kernels2, &PL); });
+   run("DiagramSetBase::value_oneLoop 2pt", [&]() { return PS.diagrams()->value_oneLoop(mom2, kernels2, &PL); });
+   run("DiagramSetBase::value_oneLoop 4pt", [&]() { return CV.diagrams()->value_oneLoop(mom4, kernels4, &PL); });
+
+   //---------------------------------------------------------------------------
+   // full integrals, one run each
+   //---------------------------------------------------------------------------
+   if (options.integrals) {
+      run("PowerSpectrum::oneLoop", [&]() { return PS.oneLoop(0.2, kernels2, &PL).result; }, 1, 0);
+      std::vector<double> kbins {0.05, 0.1, 0.15, 0.2, 0.25, 0.3, 0.35, 0.4};
+      run("PowerSpectrum::oneLoop 8 k bins", [&]() { return PS.oneLoop(kbins, kernels2, &PL).result[0]; }, 1, 0);
+      PS.set_method(IntegrationMethod::kLattice);
+      run("PowerSpectrum::oneLoop lattice QMC", [&]() { return PS.oneLoop(0.2, kernels2, &PL).result; }, 1, 0);
+      PS.set_method(IntegrationMethod::kSobol);
+      run("PowerSpectrum::oneLoop Sobol QMC", [&]() { return PS.oneLoop(0.2, kernels2, &PL).result; }, 1, 0);
+      PS.set_method(IntegrationMethod::kVEGAS);
+      run("Bispectrum::oneLoop", [&]() { return BS.oneLoop(0.2, 0.15, 2.0, kernels3, &PL).result; }, 1, 0);
+      run("Covariance::oneLoop", [&]() { return CV.oneLoop(0.2, 0.15, kernels4, &PL).result; }, 1, 0);
+   }
+
+   return 0;
+}
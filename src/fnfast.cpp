@@ -0,0 +1,646 @@
+//------------------------------------------------------------------------------
+// batch driver of the EFTofLSS library
+//
+// usage: fnfast <job file> [-o output file] [--resume] [--procs n | --rank r --ranks n]
+//        fnfast --merge <output file> <output files to merge> ...
+//
+// Computes the entries of a job on the local cores and writes one JSON object
+// per entry, in order of completion, as soon as it is done:
+//    {"index": 0, "replica": 0, "seed": 37, "observable": "covariance", "order": "oneloop",
+//     "config": [0.1, 0.1], "result": ..., "error": ..., "prob": ..., "seconds": ...}
+// Tree level results that are not integrals have error 0.  With "replicas n"
+// each entry is integrated n times, with seeds seed, seed + 1, ...
+//
+// The entries and their replicas can be split across processes: rank r of n
+// computes the ones whose position in the list of (entry, replica) is r mod n
+// and writes them to <output file>.rank<r>.  --procs n forks n such processes
+// on the local machine, waits for them and merges their output into the
+// output file; --rank and --ranks run one of them, e.g. as a batch job, and
+// under mpirun or srun they are taken from the environment (OMPI_COMM_WORLD_*,
+// PMI_*, SLURM_* in a job step), so "mpirun -n 8 bin/fnfast job -o out" partitions the job
+// without the library depending on MPI.  --merge combines output files
+// into one line per configuration, combining its estimates with different
+// seeds by inverse-variance weighting (see combine in Integration.hpp) with
+// "replicas" the number of estimates; estimates with a seed already seen for
+// the configuration are skipped, so that runs of the same job with different
+// seeds merge into the results of more statistics.  Estimates identical to
+// one with another seed are not independent and are skipped as well.
+//
+// With --resume, a line torn by the interruption is cut from the output file,
+// the entries already in it are skipped and the others appended to it, so a
+// job that was stopped continues with the entries it did not complete; with a
+// checkpoint directory, the integrals in progress also resume from their last
+// saved state (see IntegratorBase::statefile).
+//
+// The job file has one setting per line, '#' starts a comment:
+//    observable  powerspectrum | bispectrum | covariance
+//    order       tree | oneloop | eft          (eft: the EFT tree level terms)
+//    linear      <CAMB file> | analytic <n>    (default data/LIdata.txt)
+//    kmin        <IR cutoff of the CAMB linear power spectrum>
+//    qmax        <cutoff on the loop momentum>
+//    method      vegas | lattice | sobol
+//    seed        <random number seed of the integrations>
+//    replicas    <number of independent integrations of each entry>
+//    epsrel      <relative accuracy>
+//    maxeval     <maximum number of integrand evaluations>
+//    threads     <number of worker threads>
+//    cache       <result cache file, see ResultCache>
+//    checkpoint  <directory for the integration state of each entry>
+//    eft         <coefficient> <value>         (cs, c1, c2, c3, t2, t3, d1, ..., d6)
+//    k           <k> <k> ...                   (power spectrum entries)
+//    point       <configuration>               (one entry: k for the power spectrum,
+//                                               k1 k2 theta12 for the bispectrum,
+//                                               k kprime for the covariance)
+//    points      <file>                        (one configuration per line)
+//
+// Each worker thread has its own observable, kernels and linear power
+// spectrum, so that nothing but the cache and the output is shared.
+//------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "SPTkernels.hpp"
+#include "EFTkernels.hpp"
+#include "PowerSpectrum.hpp"
+#include "Bispectrum.hpp"
+#include "Covariance.hpp"
+#include "LinearPowerSpectrumAnalytic.hpp"
+#include "LinearPowerSpectrumCAMB.hpp"
+#include "ResultCache.hpp"
+
+using namespace fnfast;
+
+//------------------------------------------------------------------------------
+// job description
+//------------------------------------------------------------------------------
+struct Job
+{
+   std::string observable = "powerspectrum";        ///< powerspectrum, bispectrum, covariance
+   std::string order = "oneloop";                   ///< tree, oneloop, eft
+   std::string linear = "data/LIdata.txt";          ///< CAMB file, or "analytic n"
+   double kmin = 0;                                 ///< IR cutoff of the CAMB power spectrum
+   double qmax = -1;                                ///< loop momentum cutoff, none if negative
+   IntegrationMethod method = IntegrationMethod::kVEGAS;
+   std::string methodname = "vegas";
+   int seed = 37;
+   int replicas = 1;                                ///< integrations of each entry, with seeds seed, seed + 1, ...
+   double epsrel = 1e-3;
+   int maxeval = 250000;
+   int threads = 1;
+   std::string cache;                               ///< result cache file, none if empty
+   std::string checkpoint;                          ///< directory of the integration states, none if empty
+   EFTcoefficients coefficients;
+   std::vector<std::vector<double> > points;        ///< configuration of each entry
+
+   /// number of (entry, replica) tasks
+   size_t tasks() const { return points.size() * replicas; }
+
+   /// number of values in a configuration
+   size_t config_size() const { return (observable == "bispectrum") ? 3 : (observable == "covariance") ? 2 : 1; }
+};
+
+// reads a job file, returns an error message or an empty string
+static std::string read_job(const std::string& path, Job& job)
+{
+   std::ifstream file(path);
+   if (!file.good()) { return "cannot open job file " + path; }
+
+   std::string line;
+   int nline = 0;
+   while (std::getline(file, line)) {
+      nline++;
+      line = line.substr(0, line.find('#'));
+      std::istringstream in(line);
+      std::string key;
+      if (!(in >> key)) { continue; }
+      std::string where = path + ":" + std::to_string(nline) + ": ";
+
+      if (key == "observable") { in >> job.observable; }
+      else if (key == "order") { in >> job.order; }
+      else if (key == "linear") { std::getline(in >> std::ws, job.linear); }
+      else if (key == "kmin") { in >> job.kmin; }
+      else if (key == "qmax") { in >> job.qmax; }
+      else if (key == "seed") { in >> job.seed; }
+      else if (key == "replicas") { in >> job.replicas; }
+      else if (key == "epsrel") { in >> job.epsrel; }
+      else if (key == "maxeval") { in >> job.maxeval; }
+      else if (key == "threads") { in >> job.threads; }
+      else if (key == "cache") { in >> job.cache; }
+      else if (key == "checkpoint") { in >> job.checkpoint; }
+      else if (key == "method") {
+         in >> job.methodname;
+         if (job.methodname == "vegas") { job.method = IntegrationMethod::kVEGAS; }
+         else if (job.methodname == "lattice") { job.method = IntegrationMethod::kLattice; }
+         else if (job.methodname == "sobol") { job.method = IntegrationMethod::kSobol; }
+         else { return where + "unknown method " + job.methodname; }
+      }
+      else if (key == "eft") {
+         std::string name;
+         double value;
+         in >> name >> value;
+         bool found = false;
+         for (int i = 0; i < EFTcoefficients::kNumCoefficients; i++) {
+            EFTcoefficients::Labels label = static_cast<EFTcoefficients::Labels>(i);
+            if (name == EFTcoefficients::name(label)) {
+               job.coefficients[label] = value;
+               found = true;
+            }
+         }
+         if (!found) { return where + "unknown EFT coefficient " + name; }
+      }
+      else if (key == "k") {
+         double k;
+         while (in >> k) { job.points.push_back(std::vector<double> {k}); }
+      }
+      else if (key == "point") {
+         std::vector<double> point;
+         double value;
+         while (in >> value) { point.push_back(value); }
+         job.points.push_back(point);
+      }
+      else if (key == "points") {
+         std::string pointsfile;
+         in >> pointsfile;
+         std::ifstream points(pointsfile);
+         if (!points.good()) { return where + "cannot open points file " + pointsfile; }
+         std::string pointline;
+         while (std::getline(points, pointline)) {
+            std::istringstream pin(pointline.substr(0, pointline.find('#')));
+            std::vector<double> point;
+            double value;
+            while (pin >> value) { point.push_back(value); }
+            if (!point.empty()) { job.points.push_back(point); }
+         }
+      }
+      else { return where + "unknown setting " + key; }
+
+      if (in.bad() || (in.fail() && !in.eof())) { return where + "cannot read the value of " + key; }
+   }
+
+   if (job.observable != "powerspectrum" && job.observable != "bispectrum" && job.observable != "covariance") {
+      return "unknown observable " + job.observable;
+   }
+   if (job.order != "tree" && job.order != "oneloop" && job.order != "eft") {
+      return "unknown order " + job.order;
+   }
+   for (auto& point : job.points) {
+      if (point.size() != job.config_size()) {
+         return "a " + job.observable + " entry needs " + std::to_string(job.config_size()) + " values";
+      }
+   }
+   if (job.threads < 1) { job.threads = 1; }
+   if (job.replicas < 1) { job.replicas = 1; }
+   return "";
+}
+
+// configuration of an entry as a JSON array
+static std::string config_json(const std::vector<double>& point)
+{
+   std::ostringstream config;
+   config.precision(12);
+   config << "[";
+   for (size_t j = 0; j < point.size(); j++) {
+      config << (j ? ", " : "") << point[j];
+   }
+   config << "]";
+   return config.str();
+}
+
+// value of a field of an output line as JSON text, empty if there is none
+static std::string json_field(const std::string& line, const std::string& name)
+{
+   std::string tag = "\"" + name + "\": ";
+   size_t begin = line.find(tag);
+   if (begin == std::string::npos) { return ""; }
+   begin += tag.size();
+   size_t end = (line[begin] == '[') ? line.find(']', begin) + 1 : line.find_first_of(",}", begin);
+   return line.substr(begin, end - begin);
+}
+
+// true for a line that is one complete output object
+static bool complete_record(const std::string& line)
+{
+   return !line.empty() && line.front() == '{' && line.back() == '}'
+          && std::count(line.begin(), line.end(), '{') == 1 && std::count(line.begin(), line.end(), '}') == 1;
+}
+
+// cuts an output file back to its last complete line, removing a line torn by an interrupted write
+static bool truncate_torn(const std::string& path)
+{
+   std::ifstream file(path, std::ios::binary);
+   if (!file.good()) { return true; }
+   std::string contents((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+   size_t end = contents.find_last_of('\n');
+   end = (end == std::string::npos) ? 0 : end + 1;
+   return end == contents.size() || truncate(path.c_str(), end) == 0;
+}
+
+// marks the tasks of complete lines of an output file
+static void read_completed(const std::string& path, const Job& job, std::vector<bool>& completed)
+{
+   std::ifstream file(path);
+   std::string line;
+   while (std::getline(file, line)) {
+      if (!complete_record(line)) { continue; }
+      std::string index = json_field(line, "index");
+      std::string replica = json_field(line, "replica");
+      if (index.empty() || replica.empty()) { continue; }
+      size_t i = std::strtoul(index.c_str(), NULL, 10);
+      size_t r = std::strtoul(replica.c_str(), NULL, 10);
+      // the entry must be the same configuration
+      if (i < job.points.size() && r < size_t(job.replicas) && json_field(line, "config") == config_json(job.points[i])) {
+         completed[i * job.replicas + r] = true;
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// merges output files into one line per configuration
+//------------------------------------------------------------------------------
+static int merge(const std::string& outfile, const std::vector<std::string>& inputs)
+{
+   struct Merged
+   {
+      size_t index;                             ///< smallest index of the configuration in the inputs
+      std::string observable, order, config;    ///< JSON text of the fields
+      std::vector<std::string> seeds;           ///< seeds of the estimates
+      std::vector<IntegralResult> estimates;    ///< estimates with different seeds
+      double seconds = 0;                       ///< time of all estimates
+   };
+   std::vector<Merged> merged;
+   std::map<std::string, size_t> position;      ///< position of each configuration in merged
+   int nskipped = 0, nidentical = 0;
+
+   for (auto& input : inputs) {
+      std::ifstream file(input);
+      if (!file.good()) {
+         std::cerr << "fnfast: cannot open " << input << std::endl;
+         return 1;
+      }
+      std::string line;
+      while (std::getline(file, line)) {
+         if (!complete_record(line)) { continue; }
+         std::string observable = json_field(line, "observable"), order = json_field(line, "order"), config = json_field(line, "config");
+         std::string key = observable + " " + order + " " + config;
+         auto it = position.find(key);
+         if (it == position.end()) {
+            it = position.insert(std::make_pair(key, merged.size())).first;
+            merged.push_back(Merged());
+            merged.back().index = std::strtoul(json_field(line, "index").c_str(), NULL, 10);
+            merged.back().observable = observable;
+            merged.back().order = order;
+            merged.back().config = config;
+         }
+         Merged& entry = merged[it->second];
+
+         std::string seed = json_field(line, "seed");
+         if (!seed.empty() && std::find(entry.seeds.begin(), entry.seeds.end(), seed) != entry.seeds.end()) {
+            nskipped++;
+            continue;
+         }
+         IntegralResult estimate(std::atof(json_field(line, "result").c_str()), std::atof(json_field(line, "error").c_str()),
+                                 std::atof(json_field(line, "prob").c_str()));
+         // an integral that does not depend on the seed gives the same estimate
+         // each time, which is not an independent one
+         if (estimate.error > 0 && std::any_of(entry.estimates.begin(), entry.estimates.end(), [&](const IntegralResult& other) {
+                return other.result == estimate.result && other.error == estimate.error; })) {
+            nidentical++;
+            continue;
+         }
+         entry.index = std::min<size_t>(entry.index, std::strtoul(json_field(line, "index").c_str(), NULL, 10));
+         entry.seeds.push_back(seed);
+         entry.estimates.push_back(estimate);
+         entry.seconds += std::atof(json_field(line, "seconds").c_str());
+      }
+   }
+
+   std::ofstream out(outfile, std::ios::trunc);
+   if (!out.good()) {
+      std::cerr << "fnfast: cannot open output file " << outfile << std::endl;
+      return 1;
+   }
+   std::stable_sort(merged.begin(), merged.end(), [](const Merged& a, const Merged& b) { return a.index < b.index; });
+   size_t nestimates = 0;
+   out.precision(12);
+   for (size_t i = 0; i < merged.size(); i++) {
+      IntegralResult result = combine(merged[i].estimates);
+      nestimates += merged[i].estimates.size();
+      out << "{\"index\": " << i << ", \"observable\": " << merged[i].observable << ", \"order\": " << merged[i].order
+          << ", \"config\": " << merged[i].config << ", \"result\": " << result.result << ", \"error\": " << result.error
+          << ", \"prob\": " << result.prob << ", \"replicas\": " << merged[i].estimates.size() << ", \"seconds\": " << merged[i].seconds << "}" << std::endl;
+   }
+
+   std::cerr << "fnfast: merged " << nestimates << " estimates of " << merged.size() << " entries from " << inputs.size() << " files";
+   if (nskipped > 0) { std::cerr << ", skipped " << nskipped << " with a seed seen before"; }
+   if (nidentical > 0) { std::cerr << ", skipped " << nidentical << " identical to an estimate with another seed"; }
+   std::cerr << std::endl;
+   return 0;
+}
+
+//------------------------------------------------------------------------------
+// worker: computes entries with its own objects
+//------------------------------------------------------------------------------
+class Worker
+{
+   private:
+      const Job& _job;
+      std::unique_ptr<LinearPowerSpectrumBase> _PL;
+      SPTkernels _spt;
+      EFTkernels _eft;
+      std::unique_ptr<PowerSpectrum> _PS;
+      std::unique_ptr<Bispectrum> _BS;
+      std::unique_ptr<Covariance> _CV;
+      LabelMap<Vertex, KernelBase*> _kernels;
+
+   public:
+      Worker(const Job& job, ResultCache* cache) : _job(job), _eft(job.coefficients)
+      {
+         // linear power spectrum
+         std::istringstream linear(job.linear);
+         std::string kind;
+         linear >> kind;
+         if (kind == "analytic") {
+            int n = 1;
+            linear >> n;
+            _PL.reset(new LinearPowerSpectrumAnalytic(n));
+         } else {
+            LinearPowerSpectrumCAMB* PLcamb = new LinearPowerSpectrumCAMB(job.linear);
+            PLcamb->set_kmin(job.kmin);
+            _PL.reset(PLcamb);
+         }
+
+         // observable and its kernels, the EFT kernel at the first vertex for the EFT terms
+         KernelBase* first = (job.order == "eft") ? static_cast<KernelBase*>(&_eft) : &_spt;
+         if (job.observable == "powerspectrum") {
+            _PS.reset(new PowerSpectrum(Order::kOneLoop));
+            setup(*_PS, cache);
+            _kernels = LabelMap<Vertex, KernelBase*> {{Vertex::v1, first}, {Vertex::v2, &_spt}};
+         } else if (job.observable == "bispectrum") {
+            _BS.reset(new Bispectrum(Order::kOneLoop));
+            setup(*_BS, cache);
+            _kernels = LabelMap<Vertex, KernelBase*> {{Vertex::v1, first}, {Vertex::v2, &_spt}, {Vertex::v3, &_spt}};
+         } else {
+            _CV.reset(new Covariance(Order::kOneLoop));
+            setup(*_CV, cache);
+            _kernels = LabelMap<Vertex, KernelBase*> {{Vertex::v1, first}, {Vertex::v2, &_spt}, {Vertex::v3, &_spt}, {Vertex::v4, &_spt}};
+         }
+      }
+
+      // applies the job settings to an observable
+      template <class Observable>
+      void setup(Observable& observable, ResultCache* cache)
+      {
+         if (_job.qmax > 0) { observable.set_qmax(_job.qmax); }
+         observable.set_seed(_job.seed);
+         observable.set_method(_job.method);
+         observable.set_accuracy(_job.epsrel, _job.maxeval);
+         observable.set_cache(cache);
+      }
+
+      // checkpoint file of an entry, named by its configuration and replica
+      std::string statefile(const std::vector<double>& p, int replica) const
+      {
+         if (_job.checkpoint.empty()) { return ""; }
+         std::ostringstream name;
+         name.precision(12);
+         name << _job.checkpoint << "/" << _job.observable << "_" << _job.order;
+         for (double value : p) { name << "_" << value; }
+         if (_job.replicas > 1) { name << "_r" << replica; }
+         name << ".state";
+         return name.str();
+      }
+
+      // computes a replica of an entry
+      IntegralResult compute(const std::vector<double>& p, int replica)
+      {
+         const std::string& order = _job.order;
+         LinearPowerSpectrumBase* PL = _PL.get();
+         int seed = _job.seed + replica;
+         if (_PS) { _PS->set_seed(seed); _PS->set_statefile(statefile(p, replica)); }
+         if (_BS) { _BS->set_seed(seed); _BS->set_statefile(statefile(p, replica)); }
+         if (_CV) { _CV->set_seed(seed); _CV->set_statefile(statefile(p, replica)); }
+         if (_PS) {
+            if (order == "tree") { return IntegralResult(_PS->tree(p[0], _kernels, PL), 0, 0); }
+            if (order == "eft") { return IntegralResult(_PS->treeEFT(p[0], _kernels, PL), 0, 0); }
+            return _PS->oneLoop(p[0], _kernels, PL);
+         }
+         if (_BS) {
+            if (order == "tree") { return IntegralResult(_BS->tree(p[0], p[1], p[2], _kernels, PL), 0, 0); }
+            if (order == "eft") { return IntegralResult(_BS->treeEFT(p[0], p[1], p[2], _kernels, PL), 0, 0); }
+            return _BS->oneLoop(p[0], p[1], p[2], _kernels, PL);
+         }
+         if (order == "tree") { return _CV->tree(p[0], p[1], _kernels, PL); }
+         if (order == "eft") { return _CV->treeEFT(p[0], p[1], _kernels, PL); }
+         return _CV->oneLoop(p[0], p[1], _kernels, PL);
+      }
+};
+
+//------------------------------------------------------------------------------
+// runs rank r of n of a job, all of it for n = 1
+//------------------------------------------------------------------------------
+static int run(const Job& job, const std::string& outfile, bool resume, int rank, int ranks)
+{
+   // tasks of this rank, less those completed by an earlier run
+   std::vector<bool> completed(job.tasks(), false);
+   if (resume) {
+      if (!truncate_torn(outfile)) {
+         std::cerr << "fnfast: cannot truncate output file " << outfile << std::endl;
+         return 1;
+      }
+      read_completed(outfile, job, completed);
+   }
+   std::vector<size_t> tasks;
+   size_t ncompleted = 0;
+   for (size_t t = rank; t < job.tasks(); t += ranks) {
+      if (completed[t]) { ncompleted++; }
+      else { tasks.push_back(t); }
+   }
+
+   std::ofstream outstream;
+   if (!outfile.empty()) {
+      outstream.open(outfile, resume ? std::ios::app : std::ios::trunc);
+      if (!outstream.good()) {
+         std::cerr << "fnfast: cannot open output file " << outfile << std::endl;
+         return 1;
+      }
+   }
+   std::ostream& out = outfile.empty() ? std::cout : outstream;
+
+   if (!job.checkpoint.empty()) { mkdir(job.checkpoint.c_str(), 0755); }
+
+   std::unique_ptr<ResultCache> cache;
+   if (!job.cache.empty()) { cache.reset(new ResultCache(job.cache)); }
+
+   // each thread takes the next task until all are done
+   std::atomic<size_t> next(0);
+   std::mutex outmutex;
+   auto start = std::chrono::steady_clock::now();
+   auto work = [&]() {
+      Worker worker(job, cache.get());
+      for (size_t n = next++; n < tasks.size(); n = next++) {
+         size_t i = tasks[n] / job.replicas;
+         int replica = tasks[n] % job.replicas;
+         auto t0 = std::chrono::steady_clock::now();
+         IntegralResult result = worker.compute(job.points[i], replica);
+         double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+         std::ostringstream line;
+         line.precision(12);
+         line << "{\"index\": " << i << ", \"replica\": " << replica << ", \"seed\": " << job.seed + replica
+              << ", \"observable\": \"" << job.observable << "\", \"order\": \"" << job.order
+              << "\", \"config\": " << config_json(job.points[i]) << ", \"result\": " << result.result << ", \"error\": " << result.error
+              << ", \"prob\": " << result.prob << ", \"seconds\": " << seconds << "}";
+
+         std::lock_guard<std::mutex> lock(outmutex);
+         out << line.str() << std::endl;
+      }
+   };
+
+   int nthreads = std::min<size_t>(job.threads, std::max<size_t>(tasks.size(), 1));
+   std::vector<std::thread> threads;
+   for (int t = 1; t < nthreads; t++) { threads.push_back(std::thread(work)); }
+   work();
+   for (auto& thread : threads) { thread.join(); }
+
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   std::cerr << "fnfast: ";
+   if (ranks > 1) { std::cerr << "rank " << rank << " of " << ranks << ": "; }
+   std::cerr << tasks.size() << " entries in " << seconds << " s on " << nthreads << " threads";
+   if (cache) { std::cerr << ", " << cache->hits() << " from the cache"; }
+   if (ncompleted > 0) { std::cerr << ", " << ncompleted << " completed before"; }
+   std::cerr << std::endl;
+
+   return 0;
+}
+
+// rank and number of ranks set by an MPI or SLURM launcher of several
+// processes, false if there are none; the SLURM variables are also set in
+// the shell of an allocation, so they count only inside a job step (srun)
+static bool launcher_rank(int& rank, int& ranks)
+{
+   const char* names[][2] = {{"OMPI_COMM_WORLD_RANK", "OMPI_COMM_WORLD_SIZE"}, {"PMI_RANK", "PMI_SIZE"}, {"SLURM_PROCID", "SLURM_NTASKS"}};
+   for (auto& name : names) {
+      const char* r = std::getenv(name[0]);
+      const char* n = std::getenv(name[1]);
+      if (!r || !n || std::atoi(n) < 2) { continue; }
+      if (std::string(name[0]) == "SLURM_PROCID" && !std::getenv("SLURM_STEP_ID")) { continue; }
+      rank = std::atoi(r);
+      ranks = std::atoi(n);
+      return true;
+   }
+   return false;
+}
+
+// output file of a rank
+static std::string rank_file(const std::string& outfile, int rank)
+{
+   return outfile + ".rank" + std::to_string(rank);
+}
+
+//------------------------------------------------------------------------------
+// main routine
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+   const char* usage = "usage: fnfast <job file> [-o output file] [--resume] [--procs n | --rank r --ranks n]\n"
+                       "       fnfast --merge <output file> <output files to merge> ...";
+   std::string jobfile, outfile;
+   bool resume = false, merging = false;
+   int rank = -1, ranks = 0, procs = 1;
+   std::vector<std::string> inputs;
+   for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (merging) { inputs.push_back(arg); }
+      else if (arg == "-o" && i + 1 < argc) { outfile = argv[++i]; }
+      else if (arg == "--resume") { resume = true; }
+      else if (arg == "--procs" && i + 1 < argc) { procs = std::atoi(argv[++i]); }
+      else if (arg == "--rank" && i + 1 < argc) { rank = std::atoi(argv[++i]); }
+      else if (arg == "--ranks" && i + 1 < argc) { ranks = std::atoi(argv[++i]); }
+      else if (arg == "--merge" && jobfile.empty()) { merging = true; }
+      else if (jobfile.empty()) { jobfile = arg; }
+      else { jobfile.clear(); break; }
+   }
+
+   if (merging) {
+      if (inputs.size() < 2) {
+         std::cerr << usage << std::endl;
+         return 1;
+      }
+      return merge(inputs[0], std::vector<std::string>(inputs.begin() + 1, inputs.end()));
+   }
+
+   if (jobfile.empty() || (rank >= 0) != (ranks > 0)) {
+      std::cerr << usage << std::endl;
+      return 1;
+   }
+   if (rank < 0 && !launcher_rank(rank, ranks)) {
+      rank = 0;
+      ranks = 1;
+   }
+   if (procs < 1 || ranks < 1 || rank >= ranks || (procs > 1 && ranks > 1)) {
+      std::cerr << "fnfast: invalid number of processes or ranks" << std::endl;
+      return 1;
+   }
+   if ((resume || procs > 1 || ranks > 1) && outfile.empty()) {
+      std::cerr << "fnfast: --resume and several processes need an output file" << std::endl;
+      return 1;
+   }
+
+   Job job;
+   std::string error = read_job(jobfile, job);
+   if (!error.empty()) {
+      std::cerr << "fnfast: " << error << std::endl;
+      return 1;
+   }
+
+   // Cuba parallelizes each integral by forking workers; the entries are
+   // parallelized here instead, so the workers are turned off even if
+   // CUBACORES is set (Cuba reads it at the first integration)
+   if (job.threads > 1 || procs > 1 || ranks > 1) { setenv("CUBACORES", "0", 1); }
+
+   if (ranks > 1) { return run(job, rank_file(outfile, rank), resume, rank, ranks); }
+   if (procs == 1) { return run(job, outfile, resume, 0, 1); }
+
+   // local launcher: a process per rank, then the merge of their output
+   std::cout.flush();
+   std::vector<pid_t> pids;
+   for (int r = 0; r < procs; r++) {
+      pid_t pid = fork();
+      if (pid == 0) { _exit(run(job, rank_file(outfile, r), resume, r, procs)); }
+      if (pid < 0) {
+         std::cerr << "fnfast: cannot start process " << r << std::endl;
+         break;
+      }
+      pids.push_back(pid);
+   }
+   bool failed = (pids.size() < size_t(procs));
+   for (pid_t pid : pids) {
+      int status = 0;
+      waitpid(pid, &status, 0);
+      if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) { failed = true; }
+   }
+   if (failed) {
+      std::cerr << "fnfast: a process failed, rerun with --resume to complete the job" << std::endl;
+      return 1;
+   }
+
+   std::vector<std::string> partial;
+   for (int r = 0; r < procs; r++) { partial.push_back(rank_file(outfile, r)); }
+   return merge(outfile, partial);
+}
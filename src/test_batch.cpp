@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// test of the batched kernel functions
+//
+// Evaluates SPTkernels::alpha/beta/alpha_beta, the EFTkernels vorticity
+// kernels and Propagator::p on batches of random momenta (including lanes in
+// the IR region) and compares each lane with the scalar function of the
+// lane's momenta.  The batched functions take the steps of the scalar ones,
+// so the lanes agree bit for bit; a difference of a few units of rounding is
+// reported but accepted, for builds that contract multiply-adds.
+// Returns 0 if the test passes.
+//------------------------------------------------------------------------------
+
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+#include "SPTkernels.hpp"
+#include "EFTkernels.hpp"
+#include "Propagator.hpp"
+#include "MomentumView.hpp"
+#include "ThreeVectorBatch.hpp"
+
+using namespace fnfast;
+
+namespace {
+
+int nchecks = 0;      // number of lane comparisons
+int ninexact = 0;     // lanes that differ from the scalar result within the tolerance
+int nfailed = 0;      // lanes that differ beyond the tolerance
+
+// compare a lane with the scalar result
+void check(const char* name, double batch, double scalar)
+{
+   nchecks++;
+   if (batch == scalar) { return; }
+   double tolerance = 1e-13 * std::max(1., std::abs(scalar));
+   if (std::abs(batch - scalar) <= tolerance) { ninexact++; return; }
+   nfailed++;
+   std::cout << name << ": lane " << batch << " != scalar " << scalar << std::endl;
+}
+
+void check(const char* name, const ThreeVector& batch, const ThreeVector& scalar)
+{
+   check(name, batch.p1(), scalar.p1());
+   check(name, batch.p2(), scalar.p2());
+   check(name, batch.p3(), scalar.p3());
+}
+
+} // namespace
+
+// main routine
+int main()
+{
+   SPTkernels kernelsSPT;
+   EFTkernels kernelsEFT;
+   Propagator propagator(LabelMap<Momentum, Propagator::LabelFlow> {{Momentum::q, Propagator::LabelFlow::kMinus}, {Momentum::k1, Propagator::LabelFlow::kPlus}, {Momentum::k2, Propagator::LabelFlow::kPlus}});
+
+   std::mt19937 rng(12345);
+   std::uniform_real_distribution<double> uniform(-2., 2.);
+   auto random_vector = [&]() { return ThreeVector(uniform(rng), uniform(rng), uniform(rng)); };
+
+   int nbatches = 1000;
+   for (int b = 0; b < nbatches; b++) {
+      // one momentum batch per MomentumView slot, and the lanes as ThreeVectors
+      ThreeVectorBatch mom[MomentumView::kNumSlots];
+      ThreeVector lanes[kBatchWidth][MomentumView::kNumSlots];
+      for (int lane = 0; lane < kBatchWidth; lane++) {
+         for (int i = 0; i < MomentumView::kNumSlots; i++) {
+            lanes[lane][i] = random_vector();
+         }
+         // put a lane of every few batches in the IR region of alpha and beta
+         if (b % 4 == 0 && lane == b % kBatchWidth) { lanes[lane][MomentumView::slot(Momentum::k1)].setToZero(); }
+         if (b % 4 == 1 && lane == b % kBatchWidth) { lanes[lane][MomentumView::slot(Momentum::k2)] = ThreeVector(1e-7, 0., 0.); }
+         for (int i = 0; i < MomentumView::kNumSlots; i++) {
+            mom[i].set(lane, lanes[lane][i]);
+         }
+      }
+
+      const ThreeVectorBatch& p1 = mom[MomentumView::slot(Momentum::k1)];
+      const ThreeVectorBatch& p2 = mom[MomentumView::slot(Momentum::k2)];
+      DoubleBatch alpha = kernelsSPT.alpha(p1, p2);
+      DoubleBatch beta = kernelsSPT.beta(p1, p2);
+      DoubleBatch alphaAB, alphaBA, betaAB;
+      SPTkernels::alpha_beta(p1, p2, alphaAB, alphaBA, betaAB);
+      DoubleBatch alphaEFT = kernelsEFT.alpha(p1, p2);
+      DoubleBatch betaEFT = kernelsEFT.beta(p1, p2);
+      ThreeVectorBatch alphaOmega = kernelsEFT.alphaOmega(p1, p2);
+      ThreeVectorBatch betaOmega = kernelsEFT.betaOmega(p1, p2);
+      ThreeVectorBatch p = propagator.p(mom);
+
+      for (int lane = 0; lane < kBatchWidth; lane++) {
+         const ThreeVector& q1 = lanes[lane][MomentumView::slot(Momentum::k1)];
+         const ThreeVector& q2 = lanes[lane][MomentumView::slot(Momentum::k2)];
+         double sAB, sBA, sbeta;
+         SPTkernels::alpha_beta(q1, q2, sAB, sBA, sbeta);
+         check("SPTkernels::alpha", alpha[lane], kernelsSPT.alpha(q1, q2));
+         check("SPTkernels::beta", beta[lane], kernelsSPT.beta(q1, q2));
+         check("SPTkernels::alpha_beta alphaAB", alphaAB[lane], sAB);
+         check("SPTkernels::alpha_beta alphaBA", alphaBA[lane], sBA);
+         check("SPTkernels::alpha_beta betaAB", betaAB[lane], sbeta);
+         check("EFTkernels::alpha", alphaEFT[lane], kernelsEFT.alpha(q1, q2));
+         check("EFTkernels::beta", betaEFT[lane], kernelsEFT.beta(q1, q2));
+         check("EFTkernels::alphaOmega", alphaOmega.get(lane), kernelsEFT.alphaOmega(q1, q2));
+         check("EFTkernels::betaOmega", betaOmega.get(lane), kernelsEFT.betaOmega(q1, q2));
+         check("Propagator::p", p.get(lane), propagator.p(MomentumView(lanes[lane], MomentumView::identity())));
+      }
+   }
+
+   std::cout << nchecks << " lane comparisons, " << ninexact << " within rounding, " << nfailed << " failed" << std::endl;
+   bool passed = (nfailed == 0);
+   std::cout << (passed ? "passed" : "FAILED: batched and scalar kernel functions differ") << std::endl;
+
+   return passed ? 0 : 1;
+}
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+// test of the diagram profile of a VEGAS loop integral
+//
+// The profile is recorded in the integrand; it must have counts for each
+// diagram after the integral returns, also when Cuba would run the integrand
+// in worker processes or the integral is in the observable's cache.  The
+// integral at a set of k is not profiled.  Returns 0 if the test passes.
+//------------------------------------------------------------------------------
+
+#include <cstdio>
+#include <iostream>
+#include <unistd.h>
+
+#include "SPTkernels.hpp"
+#include "PowerSpectrum.hpp"
+#include "DiagramProfile.hpp"
+#include "LinearPowerSpectrumAnalytic.hpp"
+#include "LabelMap.hpp"
+#include "ResultCache.hpp"
+
+using namespace fnfast;
+
+// main routine
+int main()
+{
+   LinearPowerSpectrumAnalytic PL(1);
+   SPTkernels kernelsSPT;
+   LabelMap<Vertex, KernelBase*> kernels {{Vertex::v1, &kernelsSPT}, {Vertex::v2, &kernelsSPT}};
+
+   PowerSpectrum PS(Order::kOneLoop);
+   PS.set_qmax(12.);
+   PS.set_accuracy(1e-3, 20000);
+
+   // the integral is cached before the profile is attached
+   std::string cachefile = "test_profile.cache." + std::to_string(getpid());
+   ResultCache cache(cachefile);
+   PS.set_cache(&cache);
+   PS.oneLoop(0.1, kernels, &PL);
+
+   DiagramProfile profile;
+   PS.set_profile(&profile);
+
+   IntegralResult result = PS.oneLoop(0.1, kernels, &PL);
+   std::cout << "1 loop SPT PS result = " << result.result << " +- " << result.error << std::endl;
+   std::cout << profile.summary();
+
+   bool passed = (profile.npoints() > 0 && !profile.entries().empty());
+   for (auto& entry : profile.entries()) {
+      if (entry.calls <= 0) { passed = false; }
+   }
+   std::cout << (passed ? "passed" : "FAILED: the profile has no counts") << std::endl;
+
+   // the k bins of an integral at a set of k are not recorded
+   long npoints = profile.npoints();
+   PS.oneLoop(std::vector<double> {0.1, 0.2}, kernels, &PL);
+   bool kbins = (profile.npoints() == npoints);
+   std::cout << (kbins ? "passed" : "FAILED: the k bins were profiled") << std::endl;
+
+   std::remove(cachefile.c_str());
+
+   return (passed && kbins) ? 0 : 1;
+}